@@ -0,0 +1,71 @@
+#pragma once
+#ifndef animation_clock_h
+#define animation_clock_h
+
+#include <algorithm>
+
+// Animation time, advanced in fixed steps so that animation speed does not depend
+// on how fast (or how unevenly) frames are rendered. Rendering can run uncapped or
+// vsynced; every animated value is derived from this clock instead of frame counts.
+class AnimationClock {
+
+public:
+	double step;			// length of one fixed step in seconds
+	double maxFrameDelta;	// longest real frame delta honoured (stalls, window drags)
+	double fixedFrameDelta;	// > 0: every frame advances exactly this much (benchmarks)
+	long long ticks;		// fixed steps taken so far
+	double accumulator;		// real time not yet consumed by a whole step
+	bool paused;
+
+	AnimationClock(double step = 1.0 / 240.0)
+		: step(step), maxFrameDelta(0.25), fixedFrameDelta(0.0), ticks(0), accumulator(0.0), paused(false) {
+	}
+
+	// consumes one frame's worth of real time, returns the number of fixed steps taken
+	int advance(double realDelta) {
+		if (paused)
+			return 0;
+		double delta = fixedFrameDelta > 0.0 ? fixedFrameDelta : std::min(std::max(realDelta, 0.0), maxFrameDelta);
+		accumulator += delta;
+		int steps = 0;
+		// the small epsilon keeps fixedFrameDelta == n * step from losing a step to rounding
+		while (accumulator >= step - 1e-9) {
+			accumulator -= step;
+			steps++;
+		}
+		ticks += steps;
+		return steps;
+	}
+
+	double time() const {
+		return ticks * step;
+	}
+	float seconds() const {
+		return static_cast<float>(time());
+	}
+};
+
+// A value that changes at a constant rate while running, integrated over fixed steps
+// (the rotate_around camera yaw). Values that are a closed-form function of time,
+// like a RotatingPart's angle, are evaluated straight from AnimationClock::time().
+class AnimationChannel {
+
+public:
+	float value;
+	float rate;		// units per second
+	bool running;
+
+	AnimationChannel(float rate = 0.0f, float value = 0.0f) : value(value), rate(rate), running(false) {
+	}
+
+	// returns how far the value moved during 'steps' steps of 'step' seconds
+	float advance(int steps, double step) {
+		if (!running || steps == 0)
+			return 0.0f;
+		float delta = static_cast<float>(rate * steps * step);
+		value += delta;
+		return delta;
+	}
+};
+
+#endif
@@ -0,0 +1,98 @@
+#pragma once
+#ifndef benchmark_h
+#define benchmark_h
+
+#include "lighting.h"
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// Scales the number of point lights from 1 to MAX_LIGHTS (doubling each step) and
+// reports the average frame time, the CPU cost of Lighting::cull and how many
+// cluster/light pairs the shader had to walk. The lights are scattered through the
+// room from a fixed seed so runs are comparable. Each frame is finished with
+// glFinish so the GPU's shading cost is part of the measured frame time.
+class LightBenchmark {
+
+public:
+	bool active;
+	int warmupFrames;	// frames skipped after every change of light count
+	int measureFrames;	// frames averaged per light count
+
+	LightBenchmark() : active(false), warmupFrames(10), measureFrames(120), count(0), frame(0) {
+	}
+
+	void begin(Lighting& lighting) {
+		active = true;
+		saved = lighting.lights;
+		count = 1;
+		setLights(lighting);
+		printf("%8s %12s %8s %10s %12s %10s\n", "lights", "frame (ms)", "fps", "cull (ms)", "visible", "pairs");
+	}
+
+	// call once per rendered frame after the swap; returns false when the last light count is done
+	bool endFrame(Lighting& lighting) {
+		if (!active)
+			return false;
+		glFinish();
+		Clock::time_point now = Clock::now();
+		if (frame > warmupFrames) {
+			frameSeconds += std::chrono::duration<double>(now - last).count();
+			cullMilliseconds += lighting.cullMilliseconds;
+			visible += lighting.visibleLights;
+			pairs += lighting.clusterLightPairs;
+		}
+		last = now;
+		if (++frame <= warmupFrames + measureFrames)
+			return true;
+
+		double frameMs = frameSeconds * 1000.0 / measureFrames;
+		printf("%8d %12.3f %8.1f %10.3f %12.1f %10.1f\n", count, frameMs, 1000.0 / frameMs,
+			cullMilliseconds / measureFrames, visible / measureFrames, pairs / measureFrames);
+		count *= 2;
+		if (count > MAX_LIGHTS) {
+			lighting.lights = saved;
+			lighting.markDirty();
+			active = false;
+			return false;
+		}
+		setLights(lighting);
+		return true;
+	}
+
+private:
+	typedef std::chrono::steady_clock Clock;
+	std::vector<PointLight> saved;
+	int count;
+	int frame;
+	Clock::time_point last;
+	double frameSeconds, cullMilliseconds, visible, pairs;
+
+	void setLights(Lighting& lighting) {
+		std::mt19937 random(4208);
+		std::uniform_real_distribution<float> x(-2.3f, 7.3f), y(-0.6f, 2.6f), z(-8.8f, 2.8f);
+		std::uniform_real_distribution<float> radius(1.0f, 2.5f), tint(0.5f, 1.0f);
+		lighting.lights.clear();
+		for (int i = 0; i < count; i++) {
+			// one draw per statement: argument evaluation order is unspecified
+			PointLight light;
+			light.position.x = x(random);
+			light.position.y = y(random);
+			light.position.z = z(random);
+			light.radius = radius(random);
+			light.color.x = tint(random);
+			light.color.y = tint(random);
+			light.color.z = tint(random);
+			light.intensity = 8.0f / count + 0.5f;
+			lighting.lights.push_back(light);
+		}
+		lighting.markDirty();
+		frame = 0;
+		frameSeconds = cullMilliseconds = visible = pairs = 0.0;
+	}
+};
+
+#endif
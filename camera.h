@@ -37,6 +37,7 @@ const float ROLL = 0.0f;
 const float SPEED = 2.5f;
 const float SENSITIVITY = 0.1f;
 const float ZOOM = 45.0f;
+const float ORBIT_DISTANCE = 3.0f;    // how far ahead the default orbit target lies
 
 
 // An abstract camera class that processes input and calculates the corresponding Euler Angles, Vectors and Matrices for use in OpenGL
@@ -71,6 +72,7 @@ public:
         Pitch = pitch;
         Roll = roll;
         updateCameraVectors();
+        SetOrbitTarget(Position + Front * ORBIT_DISTANCE);
     }
     // constructor with scalar values
     Camera(float posX, float posY, float posZ, float upX, float upY, float upZ, float yaw, float pitch) : Front(glm::vec3(0.0f, 0.0f, -1.0f)), MovementSpeed(SPEED), MouseSensitivity(SENSITIVITY), Zoom(ZOOM)
@@ -79,23 +81,48 @@ public:
         WorldUp = glm::vec3(upX, upY, upZ);
         Yaw = yaw;
         Pitch = pitch;
+        Roll = ROLL;
         updateCameraVectors();
+        SetOrbitTarget(Position + Front * ORBIT_DISTANCE);
     }
+    // makes 'target' the point Orbit() circles; Theta (azimuth about +y) and Phi (angle from +y)
+    // are taken from where the camera is now, so starting an orbit never makes it jump
+    void SetOrbitTarget(glm::vec3 target)
+    {
+        Target = target;
+        glm::vec3 offset = Position - Target;
+        Distance = glm::length(offset);
+        Theta = atan2(offset.z, offset.x);
+        Phi = Distance > 0.0f ? acos(glm::clamp(offset.y / Distance, -1.0f, 1.0f)) : glm::radians(90.0f);
+    }
+    // moves the camera around Target by the given angles (radians) and turns it to face the target
     void Orbit(float dTheta, float dPhi) {
-        Target = GetViewMatrix()[3];
-        Distance = glm::distance(Target, Position);
         Theta += dTheta;
         Phi = glm::clamp(Phi + dPhi, 0.1f, glm::radians(179.9f));  // Avoids gimbal lock
+        Position = GetPosition();
+        LookAt(Target);
+    }
+    // turns the camera towards a point (keeps the roll)
+    void LookAt(glm::vec3 point)
+    {
+        glm::vec3 direction = point - Position;
+        if (glm::length(direction) <= 0.0f)
+            return;
+        direction = glm::normalize(direction);
+        Yaw = glm::degrees(atan2(direction.z, direction.x));
+        Pitch = glm::degrees(asin(glm::clamp(direction.y, -1.0f, 1.0f)));
+        updateCameraVectors();
     }
     // returns the view matrix calculated using Euler Angles and the LookAt Matrix
     glm::mat4 GetViewMatrix()
     {
         return glm::lookAt(Position, Position + Front, Up);
     }
+    // orbit position, y up like the rest of the scene
     glm::vec3 GetPosition() const {
         float x = Distance * sin(Phi) * cos(Theta);
-        float y = Distance * sin(Phi) * sin(Theta);
-        float z = Distance * cos(Phi);
+        float y = Distance * cos(Phi);
+        float z = Distance * sin(Phi) * sin(Theta);
         return Target + glm::vec3(x, y, z);
     }
     glm::mat4 GetViewMatrixOrbit() const {
@@ -152,6 +179,17 @@ public:
         updateCameraVectors();
     }
 
+    // places the camera directly instead of moving it (replayed or scripted motion)
+    void SetPose(glm::vec3 position, float yaw, float pitch, float roll, float zoom)
+    {
+        Position = position;
+        Yaw = yaw;
+        Pitch = pitch;
+        Roll = roll;
+        Zoom = zoom;
+        updateCameraVectors();
+    }
+
     // processes input received from a mouse scroll-wheel event. Only requires input on the vertical wheel-axis
     void ProcessMouseScroll(float yoffset)
     {
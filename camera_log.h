@@ -0,0 +1,124 @@
+#pragma once
+#ifndef camera_log_h
+#define camera_log_h
+
+#include "camera.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// what else besides the camera a sample restores (the things that change the cost of a frame)
+enum Camera_Log_Flag {
+	CAMERA_LOG_FAN = 1,			// fan turning
+	CAMERA_LOG_PREPASS = 2,		// depth pre-pass on
+	CAMERA_LOG_OCCLUSION = 4	// occlusion culling on
+};
+
+// One rendered frame: the camera, the animation clock and the render toggles
+struct CameraSample {
+	unsigned int ticks;			// AnimationClock::ticks, so replayed animation time is bit-exact
+	float position[3];
+	float yaw, pitch, roll, zoom;
+	unsigned int flags;			// Camera_Log_Flag
+};
+
+const unsigned int CAMERA_LOG_MAGIC = 0x4d414352;	// "RCAM"
+const unsigned int CAMERA_LOG_VERSION = 1;
+
+// Records the camera and animation state of every frame to a compact binary log
+// (a 16-byte header, then 36 bytes per frame), and replays such a log frame by frame:
+// replay ignores wall-clock time and live input, so every run renders exactly the
+// same sequence of frames and a slow spot a user hit can be reproduced and profiled.
+class CameraLog {
+
+public:
+	CameraLog() : replayFrame(0), replaying(false), width(0), height(0) {
+	}
+
+	bool recording() const {
+		return file.is_open();
+	}
+	bool replayActive() const {
+		return replaying;
+	}
+
+	bool startRecording(const std::string& path, int framebufferWidth, int framebufferHeight) {
+		file.open(path.c_str(), std::ios::binary);
+		if (!file) {
+			std::cout << "ERROR::CAMERA_LOG::FILE_NOT_WRITTEN: " << path << std::endl;
+			return false;
+		}
+		unsigned int header[4] = { CAMERA_LOG_MAGIC, CAMERA_LOG_VERSION, static_cast<unsigned int>(framebufferWidth), static_cast<unsigned int>(framebufferHeight) };
+		file.write(reinterpret_cast<const char*>(header), sizeof(header));
+		this->path = path;
+		return true;
+	}
+	void record(const Camera& camera, long long ticks, unsigned int flags) {
+		CameraSample sample = { static_cast<unsigned int>(ticks), { camera.Position.x, camera.Position.y, camera.Position.z },
+			camera.Yaw, camera.Pitch, camera.Roll, camera.Zoom, flags };
+		file.write(reinterpret_cast<const char*>(&sample), sizeof(sample));
+		replayFrame++;
+	}
+
+	bool startReplay(const std::string& path) {
+		std::ifstream in(path.c_str(), std::ios::binary);
+		unsigned int header[4] = { 0 };
+		if (!in || !in.read(reinterpret_cast<char*>(header), sizeof(header)) || header[0] != CAMERA_LOG_MAGIC || header[1] != CAMERA_LOG_VERSION) {
+			std::cout << "ERROR::CAMERA_LOG::NOT_A_CAMERA_LOG: " << path << std::endl;
+			return false;
+		}
+		width = static_cast<int>(header[2]);
+		height = static_cast<int>(header[3]);
+		CameraSample sample;
+		while (in.read(reinterpret_cast<char*>(&sample), sizeof(sample)))
+			samples.push_back(sample);
+		this->path = path;
+		replayFrame = 0;
+		replaying = !samples.empty();
+		return replaying;
+	}
+	// the log was taken at this framebuffer size; a different one makes timings incomparable
+	void checkViewport(int framebufferWidth, int framebufferHeight) const {
+		if (framebufferWidth != width || framebufferHeight != height)
+			std::cout << "CAMERA_LOG::VIEWPORT_MISMATCH: recorded at " << width << "x" << height << ", replaying at " << framebufferWidth << "x" << framebufferHeight << std::endl;
+	}
+	// the next frame's sample; false once the log is exhausted
+	bool next(CameraSample& sample) {
+		if (!replaying || replayFrame >= samples.size())
+			return false;
+		if (replayFrame == 0)
+			replayStart = std::chrono::steady_clock::now();
+		sample = samples[replayFrame++];
+		return true;
+	}
+	static void apply(const CameraSample& sample, Camera& camera) {
+		camera.SetPose(glm::vec3(sample.position[0], sample.position[1], sample.position[2]), sample.yaw, sample.pitch, sample.roll, sample.zoom);
+	}
+
+	void finish() {
+		if (file.is_open()) {
+			file.close();
+			printf("camera log: %d frames recorded to %s\n", static_cast<int>(replayFrame), path.c_str());
+		}
+		if (replaying && replayFrame > 0) {
+			double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - replayStart).count();
+			printf("camera log: replayed %d frames of %s in %.2f s, %.2f ms/frame (%.1f fps)\n",
+				static_cast<int>(replayFrame), path.c_str(), seconds, 1000.0 * seconds / replayFrame, replayFrame / seconds);
+		}
+		replaying = false;
+	}
+
+private:
+	std::string path;
+	std::ofstream file;
+	std::vector<CameraSample> samples;
+	size_t replayFrame;		// frames recorded, or the next frame to replay
+	bool replaying;
+	int width, height;		// framebuffer size in the log header
+	std::chrono::steady_clock::time_point replayStart;
+};
+
+#endif
@@ -0,0 +1,153 @@
+#pragma once
+#ifndef camera_path_h
+#define camera_path_h
+
+#include "camera.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// how a path gets from key to key
+enum Path_Interpolation {
+	PATH_CATMULL_ROM,	// through every key, at its time
+	PATH_BEZIER			// cubic Bezier segments: keys 0, 3, 6, ... are passed at their times, the two keys between are control points
+};
+
+// A keyframe: where the camera is and the point it looks at. Interpolating a look-at
+// point rather than yaw and pitch avoids spinning the long way round at +-180 degrees.
+struct CameraKey {
+	float time;		// seconds from the start of the path
+	glm::vec3 position;
+	glm::vec3 target;
+};
+
+// A scripted camera flight (client walkthroughs, standard benchmark flights)
+class CameraPath {
+
+public:
+	std::string name;
+	Path_Interpolation interpolation;
+	bool loop;		// wrap around after the last key instead of ending
+	std::vector<CameraKey> keys;
+
+	CameraPath(const std::string& name = "", Path_Interpolation interpolation = PATH_CATMULL_ROM, bool loop = false)
+		: name(name), interpolation(interpolation), loop(loop) {
+	}
+
+	void add(float time, glm::vec3 position, glm::vec3 target) {
+		CameraKey key = { time, position, target };
+		keys.push_back(key);
+	}
+
+	float duration() const {
+		return keys.empty() ? 0.0f : keys.back().time;
+	}
+	bool finished(float time) const {
+		return !loop && time >= duration();
+	}
+
+	void evaluate(float time, glm::vec3& position, glm::vec3& target) const {
+		if (keys.empty())
+			return;
+		if (loop && duration() > 0.0f)
+			time = std::fmod(std::max(time, 0.0f), duration());
+		if (keys.size() == 1 || time <= keys.front().time) {
+			position = keys.front().position;
+			target = keys.front().target;
+			return;
+		}
+		if (time >= keys.back().time) {
+			position = keys.back().position;
+			target = keys.back().target;
+			return;
+		}
+		int step = interpolation == PATH_BEZIER ? 3 : 1;
+		int last = static_cast<int>(keys.size()) - 1;
+		int i = 0;
+		while (i + step <= last && keys[i + step].time <= time)
+			i += step;
+		int j = std::min(i + step, last);
+		float span = keys[j].time - keys[i].time;
+		float u = span > 0.0f ? (time - keys[i].time) / span : 0.0f;
+
+		if (interpolation == PATH_BEZIER && j == i + 3) {
+			position = bezier(keys[i].position, keys[i + 1].position, keys[i + 2].position, keys[i + 3].position, u);
+			target = bezier(keys[i].target, keys[i + 1].target, keys[i + 2].target, keys[i + 3].target, u);
+			return;
+		}
+		// Catmull-Rom (also an incomplete last Bezier segment); the end keys are repeated
+		const CameraKey& k0 = keys[std::max(i - 1, 0)];
+		const CameraKey& k3 = keys[std::min(j + 1, last)];
+		position = catmullRom(k0.position, keys[i].position, keys[j].position, k3.position, u);
+		target = catmullRom(k0.target, keys[i].target, keys[j].target, k3.target, u);
+	}
+
+	// places the camera on the path (roll 0, zoom unchanged)
+	void apply(float time, Camera& camera) const {
+		glm::vec3 position = camera.Position, target = camera.Position + camera.Front;
+		evaluate(time, position, target);
+		camera.SetPose(position, camera.Yaw, camera.Pitch, 0.0f, camera.Zoom);
+		camera.LookAt(target);
+	}
+
+private:
+	static glm::vec3 catmullRom(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, float u) {
+		float u2 = u * u, u3 = u2 * u;
+		return 0.5f * ((2.0f * p1) + (p2 - p0) * u + (2.0f * p0 - 5.0f * p1 + 4.0f * p2 - p3) * u2 + (3.0f * p1 - p0 - 3.0f * p2 + p3) * u3);
+	}
+	static glm::vec3 bezier(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, float u) {
+		float v = 1.0f - u;
+		return p0 * (v * v * v) + p1 * (3.0f * v * v * u) + p2 * (3.0f * v * u * u) + p3 * (u * u * u);
+	}
+};
+
+// Flies the camera along a path on the animation clock (so --fixed-dt makes a flight
+// deterministic) and keeps the frame times of the flight for a benchmark report
+class PathPlayer {
+
+public:
+	const CameraPath* path;
+	int frames;
+	double totalMilliseconds, worstMilliseconds;
+
+	PathPlayer() : path(NULL), frames(0), totalMilliseconds(0.0), worstMilliseconds(0.0), startTime(0.0f) {
+	}
+
+	bool active() const {
+		return path != NULL;
+	}
+	void start(const CameraPath& flight, float now) {
+		path = &flight;
+		startTime = now;
+		frames = 0;
+		totalMilliseconds = worstMilliseconds = 0.0;
+	}
+
+	// positions the camera for this frame; false once a non-looping path has ended
+	bool update(Camera& camera, float now, float frameSeconds) {
+		if (!path)
+			return false;
+		float time = now - startTime;
+		path->apply(time, camera);
+		if (frames > 0) {
+			totalMilliseconds += frameSeconds * 1000.0;
+			worstMilliseconds = std::max(worstMilliseconds, frameSeconds * 1000.0);
+		}
+		frames++;
+		return !path->finished(time);
+	}
+
+	void report() const {
+		if (path && frames > 1)
+			printf("flythrough '%s': %d frames, %.2f ms/frame average (%.1f fps), %.2f ms worst\n", path->name.c_str(), frames,
+				totalMilliseconds / (frames - 1), 1000.0 * (frames - 1) / totalMilliseconds, worstMilliseconds);
+	}
+
+private:
+	float startTime;
+};
+
+#endif
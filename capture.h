@@ -0,0 +1,149 @@
+#pragma once
+#ifndef capture_h
+#define capture_h
+
+#include "render_backend.h"
+#include "spsc_queue.h"
+#include "trace.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+
+// frames that can be on their way to the encoder at once (a power of two, for SpscQueue)
+const int CAPTURE_FRAMES = 8;
+
+// which files a recording produces
+enum Capture_Format {
+	CAPTURE_IMAGES,		// <path>00000.ppm, <path>00001.ppm, ...
+	CAPTURE_RAW			// one raw RGBA stream, bottom row first, for ffmpeg
+};
+
+// Records what the renderer draws without holding up the render loop. Every frame is
+// read back through the backend's asynchronous readback (a ring of pixel buffers for
+// OpenGL) and handed to a background encoder thread over a bounded lock-free queue;
+// the images travel back on a second queue to be reused, so nothing is allocated per
+// frame. When the encoder falls behind, frames are dropped and counted rather than
+// making the render loop wait.
+class FrameRecorder {
+
+public:
+	bool active;
+	Capture_Format format;
+	std::string path;
+	double frameRate;		// stated in the ffmpeg hint; run with --fixed-dt 1/frameRate for smooth video
+	int framesWritten;
+	int framesDropped;
+
+	FrameRecorder() : active(false), format(CAPTURE_IMAGES), frameRate(60.0), framesWritten(0), framesDropped(0),
+		held(NULL), width(0), height(0), stopping(false) {
+	}
+	~FrameRecorder() {
+		stop(NULL);
+	}
+
+	void start() {
+		if (encoder.joinable())
+			return;
+		if (format == CAPTURE_RAW) {
+			raw.open(path.c_str(), std::ios::binary);
+			if (!raw) {
+				std::cout << "ERROR::CAPTURE::FILE_NOT_WRITTEN: " << path << std::endl;
+				active = false;
+				return;
+			}
+		}
+		for (int i = 0; i < CAPTURE_FRAMES; i++)
+			spare.push(&images[i]);
+		stopping = false;
+		encoder = std::thread(&FrameRecorder::encode, this);
+	}
+
+	// call after each rendered frame: asks for its pixels and passes on whatever has arrived
+	void capture(RenderBackend& backend) {
+		backend.requestPixels();
+		while (collect(backend, false)) {
+		}
+	}
+
+	// waits for the frames still in flight, lets the encoder finish and closes the files
+	void stop(RenderBackend* backend) {
+		if (!encoder.joinable())
+			return;
+		if (backend)
+			while (collect(*backend, true)) {
+			}
+		stopping = true;
+		encoder.join();
+		if (raw.is_open())
+			raw.close();
+		printf("capture: %d frames written to %s, %d dropped\n", framesWritten, path.c_str(), framesDropped);
+		if (format == CAPTURE_RAW && framesWritten > 0)
+			printf("capture: ffmpeg -f rawvideo -pixel_format rgba -video_size %dx%d -framerate %g -i %s -vf vflip capture.mp4\n",
+				width, height, frameRate, path.c_str());
+	}
+
+private:
+	FrameImage images[CAPTURE_FRAMES];
+	FrameImage scratch;		// receives frames that are dropped
+	FrameImage* held;		// taken from 'spare', not sent yet
+	SpscQueue<FrameImage*, CAPTURE_FRAMES> ready;	// render thread -> encoder
+	SpscQueue<FrameImage*, CAPTURE_FRAMES> spare;	// encoder -> render thread
+	std::thread encoder;
+	std::ofstream raw;
+	int width, height;		// of the first frame; a raw stream cannot change size
+	std::atomic<bool> stopping;
+
+	// only the encoder pushes to 'spare': an image the render thread took but did not
+	// send is kept in 'held' for the next frame
+	bool collect(RenderBackend& backend, bool wait) {
+		if (!held && !spare.pop(held))
+			held = NULL;
+		FrameImage* image = held ? held : &scratch;
+		if (!backend.readPixels(*image, wait))
+			return false;
+		if (width == 0) {
+			width = image->width;
+			height = image->height;
+		}
+		if (!held || (format == CAPTURE_RAW && (image->width != width || image->height != height))) {
+			framesDropped++;
+			return true;
+		}
+		ready.push(held);
+		held = NULL;
+		return true;
+	}
+
+	void encode() {
+		Tracer::instance().nameThread("encoder");
+		int index = 0;
+		for (;;) {
+			FrameImage* image;
+			if (!ready.pop(image)) {
+				// frames queued before the stop request are still written
+				if (stopping && ready.empty())
+					return;
+				if (!stopping)
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				continue;
+			}
+			TRACE_SCOPE("encode frame");
+			if (format == CAPTURE_RAW)
+				raw.write(reinterpret_cast<const char*>(image->rgba.data()), image->rgba.size());
+			else {
+				char name[32];
+				snprintf(name, sizeof(name), "%05d.ppm", index);
+				writePPM(path + name, image->rgba, image->width, image->height);
+			}
+			index++;
+			framesWritten++;
+			spare.push(image);
+		}
+	}
+};
+
+#endif
@@ -2,6 +2,9 @@
 #define fan_h
 
 #include "shader.h"
+#include "mesh.h"
+#include "render_queue.h"
+#include "rotating_part.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -10,15 +13,36 @@
 #include <iostream>
 #include <vector>
 
+// blade speed in degrees per second (the old per-frame step of 5 degrees at 60 fps)
+const float FAN_SPEED = 300.0f;
+
 class Fan {
 
 public:
 	std::vector<glm::mat4> modelMatrices;
 	float tox, toy, toz;
+	RotatingPart spin;
 	Fan(float x = 0, float y = 0, float z = 0) {
 		tox = x;
 		toy = y;
 		toz = z;
+
+		// the blades never move on the CPU: they are placed once here and spun
+		// about their common centre in the vertex shader (see rotating_part.h)
+		float rotateAngle_X = 0;
+		float rotateAngle_Y = 0;
+		float rotateAngle_Z = 0;
+		modelMatrices.push_back(transforamtion(2.125, 2.35, -5.625, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, .5, .05, 2));
+		modelMatrices.push_back(transforamtion(2.375, 2.35, -5.875, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, -.5, .05, -2));
+		modelMatrices.push_back(transforamtion(2.375, 2.35, -5.875, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 2, .05, .5));
+		modelMatrices.push_back(transforamtion(2.125, 2.35, -5.625, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, -2, .05, -.5));
+
+		glm::vec3 averagePosition(0.0f);
+		for (const glm::mat4& model : modelMatrices) {
+			averagePosition += glm::vec3(model[3]);
+		}
+		averagePosition /= modelMatrices.size();
+		spin = RotatingPart(averagePosition, glm::vec3(0.0f, 1.0f, 0.0f), FAN_SPEED);
 	}
 	glm::mat4 transforamtion(float tx, float ty, float tz, float rx, float ry, float rz, float sx, float sy, float sz) {
 		tx += tox;
@@ -35,76 +59,11 @@ public:
 		return model;
 	}
 
-	Shader local_rotation(Shader ourShader, unsigned int VAOF3, float angle = 0) {
-		glm::mat4 model;
-		float rotateAngle_X = 0;
-		float rotateAngle_Y = 0;
-		float rotateAngle_Z = 0;
-		
-		model = transforamtion(2.125, 2.35, -5.625, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, .5, .05, 2);
-		modelMatrices.push_back(model);
-		model = transforamtion(2.375, 2.35, -5.875, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, -.5, .05, -2);
-		modelMatrices.push_back(model);
-		model = transforamtion(2.375, 2.35, -5.875, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 2, .05, .5);
-		modelMatrices.push_back(model);
-		model = transforamtion(2.125, 2.35, -5.625, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, -2, .05, -.5);
-		modelMatrices.push_back(model);
-
-		unsigned int vertex_array[] = { VAOF3, VAOF3, VAOF3, VAOF3 };
-		glm::vec3 averagePosition(0.0f);
+	// the blades are the scene's only dynamic draws: they carry the spin with them
+	void submit(RenderQueue& queue, const Mesh& meshF3) {
 		for (const glm::mat4& model : modelMatrices) {
-			averagePosition += glm::vec3(model[3]);
+			queue.add(meshF3, model, &spin);
 		}
-
-		averagePosition /= modelMatrices.size();
-
-		glm::mat4 moveToOrigin = glm::translate(glm::mat4(1.0f), -averagePosition);
-
-		glm::mat4 rotation = glm::rotate(glm::mat4(1.0f), glm::radians(angle), glm::vec3(0.0f, 1.0f, 0.0f));
-
-		glm::mat4 moveToOriginalPosition = glm::translate(glm::mat4(1.0f), averagePosition);
-
-		glm::mat4 groupTransform = moveToOriginalPosition * rotation * moveToOrigin;
-
-		int i = 0;
-		for (glm::mat4& model : modelMatrices) {
-
-			model = groupTransform * model;
-			ourShader.setMat4("model", model);
-			glBindVertexArray(vertex_array[i]);
-			glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-			i++;
-		}
-		return ourShader;
-	}
-
-	Shader ret_shader(Shader ourShader, unsigned int VAOF2, unsigned int VAOF3) {
-		glm::mat4 model;
-		float rotateAngle_X = 0;
-		float rotateAngle_Y = 0;
-		float rotateAngle_Z = 0;
-
-		
-		model = transforamtion(2.125, 2.35, -5.625, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, .5, .05, 2);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAOF3);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-		model = transforamtion(2.375, 2.35, -5.875, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, -.5, .05, -2);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAOF3);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-		model = transforamtion(2.375, 2.35, -5.875, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 2, .05, .5);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAOF3);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-		model = transforamtion(2.125, 2.35, -5.625, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, -2, .05, -.5);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAOF3);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-		return ourShader;
 	}
 };
 
@@ -1,9 +1,104 @@
 #version 330 core
+// variants (shader_variants.h): LIT shades with the clustered lights and SHADOWED adds the
+// lamps' shadow maps; without LIT nothing is written (depth only)
+#ifdef LIT
 in vec4 color;
+in vec3 FragPos;
+in vec3 Normal;
 
 out vec4 FragColor;
 
+// must match CLUSTER_X / CLUSTER_Y / CLUSTER_Z in lighting.h
+const int CLUSTER_X = 16;
+const int CLUSTER_Y = 9;
+const int CLUSTER_Z = 24;
+
+struct Material {
+    float ambient;
+    float diffuse;
+    float specular;
+    float shininess;
+};
+
+// point lights, three texels each: xyz = position, w = radius / rgb = colour, a = intensity / x = shadow layer (-1: none)
+uniform samplerBuffer lightData;
+
+#ifdef SHADOWED
+// must match MAX_SHADOWS in shadow.h
+#define MAX_SHADOWS 8
+uniform sampler2DArrayShadow shadowMaps;
+uniform mat4 shadowMatrices[MAX_SHADOWS];
+#endif
+
+// per-cluster light lists built by Lighting::cull
+uniform usamplerBuffer clusterLights;  // (offset, count) per cluster
+uniform usamplerBuffer lightIndices;   // light indices, cluster after cluster
+uniform vec2 clusterTileSize;          // pixels per cluster tile
+uniform float clusterNear;             // projection near/far planes
+uniform float clusterFar;
+uniform float sliceScale;              // slice = log(depth) * sliceScale + sliceBias
+uniform float sliceBias;
+
+uniform Material material;
+uniform vec3 ambientColor;
+uniform vec3 viewPos;
+
+#ifdef SHADOWED
+// 1 = lit, 0 = in shadow; fragments outside the lamp's shadow cone are lit
+float shadow(int layer, vec3 normal)
+{
+    // small push along the normal against acne on surfaces facing away from the lamp
+    vec4 lightSpace = shadowMatrices[layer] * vec4(FragPos + normal * 0.01, 1.0);
+    vec3 p = lightSpace.xyz / lightSpace.w * 0.5 + 0.5;
+    if (lightSpace.w <= 0.0 || any(lessThan(p, vec3(0.0))) || any(greaterThan(p, vec3(1.0))))
+        return 1.0;
+    return texture(shadowMaps, vec4(p.xy, float(layer), p.z));
+}
+#endif
+
+void main()
+{
+    vec3 albedo = color.rgb;
+    vec3 normal = normalize(Normal);
+    vec3 viewDir = normalize(viewPos - FragPos);
+    vec3 result = material.ambient * ambientColor * albedo;
+
+    // find this fragment's cluster from its pixel and its linear view depth
+    float depth = clusterNear * clusterFar / (clusterFar - gl_FragCoord.z * (clusterFar - clusterNear));
+    ivec2 tile = min(ivec2(gl_FragCoord.xy / clusterTileSize), ivec2(CLUSTER_X - 1, CLUSTER_Y - 1));
+    int slice = clamp(int(log(depth) * sliceScale + sliceBias), 0, CLUSTER_Z - 1);
+    uvec2 range = texelFetch(clusterLights, (slice * CLUSTER_Y + tile.y) * CLUSTER_X + tile.x).xy;
+    for (uint i = 0u; i < range.y; i++)
+    {
+        int light = int(texelFetch(lightIndices, int(range.x + i)).r);
+        vec4 positionRadius = texelFetch(lightData, light * 3);
+        vec3 toLight = positionRadius.xyz - FragPos;
+        float dist = length(toLight);
+        if (dist >= positionRadius.w)
+            continue;
+        vec3 lightDir = toLight / dist;
+        // inverse-square falloff windowed to reach exactly zero at the light's radius
+        float window = clamp(1.0 - pow(dist / positionRadius.w, 4.0), 0.0, 1.0);
+        float attenuation = window * window / (1.0 + dist * dist);
+
+        // Blinn-Phong
+        float diffuse = max(dot(normal, lightDir), 0.0);
+        vec3 halfway = normalize(lightDir + viewDir);
+        float specular = diffuse > 0.0 ? pow(max(dot(normal, halfway), 0.0), material.shininess) : 0.0;
+
+        vec4 colorIntensity = texelFetch(lightData, light * 3 + 1);
+#ifdef SHADOWED
+        int shadowLayer = int(texelFetch(lightData, light * 3 + 2).x);
+        if (shadowLayer >= 0)
+            attenuation *= shadow(shadowLayer, normal);
+#endif
+        result += (albedo * diffuse * material.diffuse + specular * material.specular) * colorIntensity.rgb * colorIntensity.a * attenuation;
+    }
+    FragColor = vec4(result, 1.0);
+}
+#else
+// depth only: shadow maps and the depth pre-pass write no colour
 void main()
 {
-    FragColor = color;
-}
\ No newline at end of file
+}
+#endif
@@ -0,0 +1,93 @@
+#pragma once
+#ifndef frame_pacer_h
+#define frame_pacer_h
+
+#include "trace.h"
+#include <GLFW/glfw3.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#ifdef _WIN32
+// raise the scheduler tick to 1 ms so sleep_until can hit frame deadlines
+// (declared here rather than pulling <windows.h> in after glad)
+extern "C" __declspec(dllimport) unsigned int __stdcall timeBeginPeriod(unsigned int uPeriod);
+extern "C" __declspec(dllimport) unsigned int __stdcall timeEndPeriod(unsigned int uPeriod);
+#pragma comment(lib, "winmm.lib")
+#endif
+
+// Decides when frames are produced: swap interval (vsync), an optional frame-rate
+// cap using high-resolution sleeps, and an on-demand mode that blocks in
+// glfwWaitEvents while nothing is animating and no input or resize has arrived.
+class FramePacer {
+
+public:
+	int swapInterval;	// 0 = uncapped, 1 = vsync, 2 = every other refresh, ...
+	double targetFps;	// 0 = no limiter
+	bool onDemand;		// render only when the frame is dirty
+
+	FramePacer() : swapInterval(1), targetFps(0.0), onDemand(false), dirty(true) {
+#ifdef _WIN32
+		timeBeginPeriod(1);
+#endif
+	}
+	~FramePacer() {
+#ifdef _WIN32
+		timeEndPeriod(1);
+#endif
+	}
+
+	// call with the window's context current
+	void apply() {
+		glfwSwapInterval(swapInterval);
+		nextDeadline = Clock::now();
+	}
+
+	// input callbacks and resizes mark the frame dirty (main thread)
+	void markDirty() {
+		dirty.store(true, std::memory_order_relaxed);
+	}
+	// from any thread: mark dirty and wake a main loop blocked in waitForEvents
+	void requestFrame() {
+		markDirty();
+		glfwPostEmptyEvent();
+	}
+
+	// whether this iteration should render; clears the dirty flag
+	bool frameNeeded(bool animating) {
+		bool wasDirty = dirty.exchange(false, std::memory_order_relaxed);
+		return !onDemand || animating || wasDirty;
+	}
+	// idle: sleep until the next event instead of spinning
+	void waitForEvents() {
+		glfwWaitEvents();
+		nextDeadline = Clock::now();
+	}
+
+	// call after swapping buffers: sleeps until the next frame deadline
+	void limit() {
+		if (targetFps <= 0.0)
+			return;
+		TRACE_SCOPE("frame limiter");
+		nextDeadline += std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / targetFps));
+		Clock::time_point now = Clock::now();
+		if (nextDeadline <= now) {
+			// fell behind (slow frame or idle): restart the schedule rather than rushing to catch up
+			nextDeadline = now;
+			return;
+		}
+		// the OS sleep is only trusted to within ~2 ms; the remainder is spent yielding
+		Clock::time_point coarse = nextDeadline - std::chrono::milliseconds(2);
+		if (now < coarse)
+			std::this_thread::sleep_until(coarse);
+		while (Clock::now() < nextDeadline)
+			std::this_thread::yield();
+	}
+
+private:
+	typedef std::chrono::steady_clock Clock;
+	std::atomic<bool> dirty;
+	Clock::time_point nextDeadline;
+};
+
+#endif
@@ -0,0 +1,253 @@
+#pragma once
+#ifndef gl_backend_h
+#define gl_backend_h
+
+#include "shader.h"
+#include "shader_variants.h"
+#include "render_backend.h"
+#include "lighting.h"
+#include "shadow.h"
+#include "overdraw.h"
+#include "occlusion.h"
+#include "gpu_timer.h"
+#include "render_queue.h"
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstring>
+#include <deque>
+#include <vector>
+
+// pixel buffers frames are read back through; a request only blocks once all are in flight
+const int READBACK_BUFFERS = 3;
+
+// the shader variants drawn with
+const unsigned int DEPTH_VARIANT = 0;							// depth pre-pass, shadow maps, occlusion boxes
+const unsigned int LIT_VARIANT = SHADER_LIT | SHADER_SHADOWED;	// the shaded pass
+
+// The OpenGL renderer: cached shadow maps, clustered lighting, front-to-back ordering
+// with an optional depth pre-pass, and occlusion-query culling of furniture groups.
+// Frames are read back asynchronously: glReadPixels goes into a pixel buffer object and
+// a fence tells when the copy is done, so the CPU maps it frames later without stalling.
+// Needs a current context for its whole lifetime.
+class GLBackend : public RenderBackend {
+
+public:
+	ShaderVariants shaders;
+	ShadowMaps shadows;
+	OverdrawCounter overdraw;
+	OcclusionCuller occlusion;
+	GpuTimers timers;	// per pass and per part of the restaurant, when enabled before init()
+	bool depthPrepass;
+	bool offscreen;		// draw into an own render target instead of the window
+	glm::vec3 clearColor;
+
+	GLBackend(const char* vertexPath, const char* fragmentPath, ShaderCache* shaderCache = NULL)
+		: shaders(vertexPath, fragmentPath, shaderCache),
+		depthPrepass(true), offscreen(false), clearColor(0.2f, 0.3f, 0.3f), lastViewport(1, 1), nextReadback(0), oldestReadback(0) {
+		shaders.prewarm({ DEPTH_VARIANT, LIT_VARIANT });
+		shadowScope = timers.addScope("shadows");
+		prepassScope = timers.addScope("pre-pass");
+		for (int c = 0; c < DRAW_CATEGORIES; c++)
+			categoryScopes[c] = timers.addScope(DRAW_CATEGORY_NAMES[c]);
+		occlusionScope = timers.addScope("occlusion");
+	}
+
+	// the scene must be fully recorded and 'lighting' initialised
+	void init(RenderQueue& scene, Lighting& lighting, const std::vector<int>& shadowedLights) {
+		shadows.init(lighting, shadowedLights);
+		overdraw.init();
+		occlusion.init(scene);
+		timers.init();
+		for (int i = 0; i < READBACK_BUFFERS; i++) {
+			glGenBuffers(1, &readbacks[i].PBO);
+			glGenQueries(2, readbacks[i].timestamps);
+		}
+	}
+	void release(RenderQueue& scene) {
+		shadows.release();
+		overdraw.release();
+		occlusion.release(scene);
+		timers.release();
+		target.release();
+		for (int i = 0; i < READBACK_BUFFERS; i++) {
+			if (readbacks[i].fence)
+				glDeleteSync(readbacks[i].fence);
+			glDeleteBuffers(1, &readbacks[i].PBO);
+			glDeleteQueries(2, readbacks[i].timestamps);
+		}
+	}
+
+	const char* name() const {
+		return "opengl";
+	}
+
+	void render(RenderQueue& scene, Lighting& lighting, const FrameParams& frame) {
+		TRACE_SCOPE("gl render");
+		scene.resetStats();
+		// the buffer this frame will be read back through must be free for its timestamps
+		Readback& readback = readbacks[nextReadback];
+		if (readback.fence) {
+			arrived.push_back(FrameImage());
+			collect(readback, arrived.back());
+		}
+		glQueryCounter(readback.timestamps[0], GL_TIMESTAMP);
+		Shader& litShader = shaders.get<LIT_VARIANT>();
+		Shader& depthShader = shaders.get<DEPTH_VARIANT>();
+		timers.beginFrame();
+
+		// shadow maps: static casters are cached, only moved fan blades are redrawn
+		timers.begin(shadowScope);
+		shadows.update(scene, depthShader, frame.time, frame.viewport);
+		timers.end(shadowScope);
+		if (offscreen) {
+			if (target.width != frame.viewport.width || target.height != frame.viewport.height)
+				target.release();
+			target.ensure(frame.viewport);
+			target.bind();
+		}
+
+		glClearColor(clearColor.r, clearColor.g, clearColor.b, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		litShader.use();
+		litShader.setMat4("projection", frame.projection);
+		litShader.setMat4("view", frame.view);
+		litShader.setFloat("time", frame.time);
+
+		// bin the lights into clusters for this view and hand the lists to the shader
+		lighting.cull(frame.view, frame.projection, frame.viewport);
+		lighting.apply(litShader, frame.eye, frame.viewport);
+		shadows.apply(litShader);
+
+		// opaque draws nearest first, so early depth testing rejects what they hide
+		scene.sortFrontToBack(frame.eye);
+		if (depthPrepass) {
+			// depth pre-pass: lay down the final depth without shading, then shade only the
+			// fragments that match it, so the lighting loop runs once per pixel
+			depthShader.use();
+			depthShader.setMat4("projection", frame.projection);
+			depthShader.setMat4("view", frame.view);
+			depthShader.setFloat("time", frame.time);
+			glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+			timers.begin(prepassScope);
+			scene.drawDepth(depthShader, DRAW_ALL, occlusion.enabled);
+			timers.end(prepassScope);
+			glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+			glDepthFunc(GL_LEQUAL);
+			glDepthMask(GL_FALSE);
+			litShader.use();
+		}
+		overdraw.begin(frame.viewport);
+		if (timers.active()) {
+			// timed part by part (each still front to back), at the cost of a less strict order overall
+			for (int c = 0; c < DRAW_CATEGORIES; c++) {
+				timers.begin(categoryScopes[c]);
+				scene.draw(litShader, DRAW_ALL, occlusion.enabled, c);
+				timers.end(categoryScopes[c]);
+			}
+		}
+		else {
+			TRACE_SCOPE("lit pass");
+			scene.draw(litShader, DRAW_ALL, occlusion.enabled);
+		}
+		overdraw.end();
+		glDepthFunc(GL_LESS);
+		glDepthMask(GL_TRUE);
+
+		// test every furniture group's box against this frame's depth for the next frame
+		timers.begin(occlusionScope);
+		occlusion.query(scene, depthShader, frame.view, frame.projection, frame.eye);
+		timers.end(occlusionScope);
+		if (offscreen)
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glQueryCounter(readback.timestamps[1], GL_TIMESTAMP);
+		timers.endFrame();
+		lastViewport = frame.viewport;
+	}
+
+	void requestPixels() {
+		TRACE_SCOPE("request pixels");
+		Readback& readback = readbacks[nextReadback];
+		readback.width = lastViewport.width;
+		readback.height = lastViewport.height;
+		size_t size = static_cast<size_t>(readback.width) * readback.height * 4;
+		if (offscreen)
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, target.FBO);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.PBO);
+		// orphaning the storage keeps the driver from waiting on a previous mapping
+		glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, readback.width, readback.height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		if (offscreen)
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+		readback.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		nextReadback = (nextReadback + 1) % READBACK_BUFFERS;
+	}
+
+	// reusing the same 'image' every frame avoids reallocating its pixels
+	bool readPixels(FrameImage& image, bool wait) {
+		if (!arrived.empty()) {
+			image.rgba.swap(arrived.front().rgba);
+			image.width = arrived.front().width;
+			image.height = arrived.front().height;
+			image.renderMilliseconds = arrived.front().renderMilliseconds;
+			arrived.pop_front();
+			return true;
+		}
+		Readback& oldest = readbacks[oldestReadback];
+		if (!oldest.fence)
+			return false;
+		if (!wait && glClientWaitSync(oldest.fence, 0, 0) == GL_TIMEOUT_EXPIRED)
+			return false;
+		collect(oldest, image);
+		return true;
+	}
+
+private:
+	// one frame on its way back from the GPU
+	struct Readback {
+		unsigned int PBO;
+		GLsync fence;				// set while a copy is in flight
+		unsigned int timestamps[2];	// GPU clock at the start and end of the frame
+		int width, height;
+
+		Readback() : PBO(0), fence(0), width(0), height(0) {
+			timestamps[0] = timestamps[1] = 0;
+		}
+	};
+
+	int shadowScope, prepassScope, occlusionScope, categoryScopes[DRAW_CATEGORIES];
+	Viewport lastViewport;
+	RenderTarget target;	// when offscreen
+	Readback readbacks[READBACK_BUFFERS];
+	int nextReadback;		// buffer the next requestPixels() uses
+	int oldestReadback;		// oldest buffer with a copy in flight
+	std::deque<FrameImage> arrived;	// frames collected early to free their buffer
+
+	// waits for the copy (usually long done) and maps it into 'image'
+	void collect(Readback& readback, FrameImage& image) {
+		TRACE_SCOPE("map readback");
+		glClientWaitSync(readback.fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+		glDeleteSync(readback.fence);
+		readback.fence = 0;
+		image.width = readback.width;
+		image.height = readback.height;
+		size_t size = static_cast<size_t>(image.width) * image.height * 4;
+		image.rgba.resize(size);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.PBO);
+		const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+		if (pixels) {
+			std::memcpy(image.rgba.data(), pixels, size);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		GLuint64 start = 0, end = 0;
+		glGetQueryObjectui64v(readback.timestamps[0], GL_QUERY_RESULT, &start);
+		glGetQueryObjectui64v(readback.timestamps[1], GL_QUERY_RESULT, &end);
+		image.renderMilliseconds = (end - start) / 1.0e6;
+		oldestReadback = (oldestReadback + 1) % READBACK_BUFFERS;
+	}
+};
+
+#endif
@@ -2,6 +2,8 @@
 #define glass_h
 
 #include "shader.h"
+#include "mesh.h"
+#include "render_queue.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -35,7 +37,7 @@ public:
 	}
 
 
-	Shader ret_shader(Shader ourShader, unsigned int VAO_CIRC, unsigned int VAO2, unsigned int VAO3) {
+	void submit(RenderQueue& queue, const Mesh& meshCirc) {
 
 		glm::mat4 model;
 		float rotateAngle_X = 0;
@@ -45,10 +47,7 @@ public:
 		//lower portion
 		model = transforamtion(0.25, 1.678, .8, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, .1, 0.2, .1);
 		modelMatrices.push_back(model);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAO_CIRC);
-		glDrawElements(GL_TRIANGLES, 90, GL_UNSIGNED_INT, 0);
-		return ourShader;
+		queue.add(meshCirc, model);
 	}
 };
 
@@ -0,0 +1,180 @@
+#pragma once
+#ifndef gpu_timer_h
+#define gpu_timer_h
+
+#include "trace.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// frames of timestamp queries in flight; results are read when a frame's set comes round again
+const int GPU_TIMER_FRAMES = 2;
+
+// Named timing scopes for the render passes and the parts of the scene. Each scope
+// records the CPU time spent issuing it and, through a GL_TIMESTAMP query at either
+// end, the GPU time it took. Queries are double-buffered: a frame's results are read
+// two frames later, when its query set is about to be reused, and only if the GPU has
+// already delivered them, so timing never stalls the pipeline (a late frame is counted
+// as dropped instead). Every 'interval' frames the averages and worst GPU times per
+// scope are printed and kept in 'averages' for display. While a trace is recorded,
+// every scope also becomes a trace event, with or without the queries.
+class GpuTimers {
+
+public:
+	bool enabled;
+	int interval;		// frames aggregated per report
+	int dropped;		// frames whose results were not ready in time
+
+	// per scope and frame it ran in, over the last completed interval
+	struct Average {
+		double cpuMilliseconds, gpuMilliseconds, gpuWorstMilliseconds;
+	};
+	std::vector<std::string> names;
+	std::vector<Average> averages;
+
+	GpuTimers() : enabled(false), interval(120), dropped(0), current(0), frames(0), gpuFrames(0), initialised(false), traceStart(-1) {
+	}
+
+	// before init(); the names must not change afterwards (trace events point at them)
+	int addScope(const std::string& name) {
+		names.push_back(name);
+		Average zero = { 0.0, 0.0, 0.0 };
+		averages.push_back(zero);
+		return static_cast<int>(names.size()) - 1;
+	}
+
+	bool active() const {
+		return initialised;
+	}
+
+	void init() {
+		if (!enabled || initialised)
+			return;
+		for (int f = 0; f < GPU_TIMER_FRAMES; f++) {
+			sets[f].queries.resize(names.size() * 2);
+			sets[f].issued.assign(names.size(), false);
+			sets[f].last = -1;
+			sets[f].pending = false;
+			glGenQueries(static_cast<GLsizei>(sets[f].queries.size()), sets[f].queries.data());
+		}
+		sums.assign(names.size(), Sum());
+		initialised = true;
+	}
+	void release() {
+		if (!initialised)
+			return;
+		for (int f = 0; f < GPU_TIMER_FRAMES; f++)
+			glDeleteQueries(static_cast<GLsizei>(sets[f].queries.size()), sets[f].queries.data());
+		initialised = false;
+	}
+
+	// the set this frame writes: the frame that used it last is collected first, if it is done
+	void beginFrame() {
+		if (!initialised)
+			return;
+		collect(sets[current]);
+		std::fill(sets[current].issued.begin(), sets[current].issued.end(), false);
+		sets[current].last = -1;
+	}
+	void begin(int scope) {
+		traceStart = Tracer::instance().enabled() ? Tracer::instance().now() : -1;
+		if (!initialised)
+			return;
+		cpuStart = std::chrono::steady_clock::now();
+		glQueryCounter(sets[current].queries[scope * 2], GL_TIMESTAMP);
+	}
+	void end(int scope) {
+		if (traceStart >= 0)
+			Tracer::instance().record(names[scope].c_str(), traceStart, Tracer::instance().now());
+		if (!initialised)
+			return;
+		glQueryCounter(sets[current].queries[scope * 2 + 1], GL_TIMESTAMP);
+		sets[current].issued[scope] = true;
+		sets[current].last = scope;
+		sums[scope].cpuMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cpuStart).count();
+		sums[scope].cpuSamples++;
+	}
+	void endFrame() {
+		if (!initialised)
+			return;
+		sets[current].pending = true;
+		current = (current + 1) % GPU_TIMER_FRAMES;
+		if (++frames >= interval)
+			report();
+	}
+
+private:
+	// one frame's queries: a start and an end timestamp per scope
+	struct QuerySet {
+		std::vector<GLuint> queries;
+		std::vector<bool> issued;	// scopes this frame actually ran
+		int last;					// scope ended last, -1 for none
+		bool pending;				// written and not collected yet
+	};
+	struct Sum {
+		double cpuMilliseconds, gpuMilliseconds, gpuWorstMilliseconds;
+		int cpuSamples, gpuSamples;
+		Sum() : cpuMilliseconds(0.0), gpuMilliseconds(0.0), gpuWorstMilliseconds(0.0), cpuSamples(0), gpuSamples(0) {
+		}
+	};
+
+	QuerySet sets[GPU_TIMER_FRAMES];
+	std::vector<Sum> sums;
+	int current;
+	int frames;			// in this interval
+	int gpuFrames;		// of them, with GPU results
+	bool initialised;
+	std::chrono::steady_clock::time_point cpuStart;
+	long long traceStart;	// -1 while not tracing
+
+	void collect(QuerySet& set) {
+		if (!set.pending)
+			return;
+		set.pending = false;
+		// timestamps complete in order: when the frame's last one is there, all are
+		if (set.last < 0)
+			return;
+		GLint available = 0;
+		glGetQueryObjectiv(set.queries[set.last * 2 + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) {
+			dropped++;
+			return;
+		}
+		for (int s = 0; s < static_cast<int>(names.size()); s++) {
+			if (!set.issued[s])
+				continue;
+			GLuint64 start = 0, end = 0;
+			glGetQueryObjectui64v(set.queries[s * 2], GL_QUERY_RESULT, &start);
+			glGetQueryObjectui64v(set.queries[s * 2 + 1], GL_QUERY_RESULT, &end);
+			double milliseconds = (end - start) / 1.0e6;
+			sums[s].gpuMilliseconds += milliseconds;
+			sums[s].gpuWorstMilliseconds = std::max(sums[s].gpuWorstMilliseconds, milliseconds);
+			sums[s].gpuSamples++;
+		}
+		gpuFrames++;
+	}
+
+	void report() {
+		printf("gpu timers: %d frames, %d with GPU results (%d dropped so far)\n", frames, gpuFrames, dropped);
+		printf("%-14s %10s %10s %10s\n", "scope", "cpu ms", "gpu ms", "gpu worst");
+		double cpuTotal = 0.0, gpuTotal = 0.0;
+		for (size_t s = 0; s < names.size(); s++) {
+			Average& average = averages[s];
+			average.cpuMilliseconds = sums[s].cpuSamples ? sums[s].cpuMilliseconds / sums[s].cpuSamples : 0.0;
+			average.gpuMilliseconds = sums[s].gpuSamples ? sums[s].gpuMilliseconds / sums[s].gpuSamples : 0.0;
+			average.gpuWorstMilliseconds = sums[s].gpuWorstMilliseconds;
+			cpuTotal += average.cpuMilliseconds;
+			gpuTotal += average.gpuMilliseconds;
+			printf("%-14s %10.3f %10.3f %10.3f\n", names[s].c_str(), average.cpuMilliseconds, average.gpuMilliseconds, average.gpuWorstMilliseconds);
+			sums[s] = Sum();
+		}
+		printf("%-14s %10.3f %10.3f\n", "total", cpuTotal, gpuTotal);
+		frames = 0;
+		gpuFrames = 0;
+	}
+};
+
+#endif
@@ -0,0 +1,14 @@
+#version 330 core
+// the performance HUD (hud.h): glyph coverage from the font atlas times the quad's colour;
+// solid quads sample the atlas's one opaque glyph
+in vec2 TexCoord;
+in vec4 Color;
+
+out vec4 FragColor;
+
+uniform sampler2D font;
+
+void main()
+{
+    FragColor = vec4(Color.rgb, Color.a * texture(font, TexCoord).r);
+}
@@ -0,0 +1,319 @@
+#pragma once
+#ifndef hud_h
+#define hud_h
+
+#include "shader.h"
+#include "shader_cache.h"
+#include "render_queue.h"
+#include "occlusion.h"
+#include "viewport.h"
+#include "trace.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+// psapi's PROCESS_MEMORY_COUNTERS and the kernel32 entry point behind GetProcessMemoryInfo,
+// declared here rather than pulling <windows.h> in after glad
+struct HudProcessMemoryCounters {
+	unsigned long cb, pageFaultCount;
+	size_t peakWorkingSetSize, workingSetSize;
+	size_t quotaPeakPagedPoolUsage, quotaPagedPoolUsage, quotaPeakNonPagedPoolUsage, quotaNonPagedPoolUsage;
+	size_t pagefileUsage, peakPagefileUsage;
+};
+extern "C" __declspec(dllimport) void* __stdcall GetCurrentProcess();
+extern "C" __declspec(dllimport) int __stdcall K32GetProcessMemoryInfo(void* process, HudProcessMemoryCounters* counters, unsigned long cb);
+#elif defined(__linux__)
+#include <unistd.h>
+#endif
+
+const int HUD_FONT_TEXTURE_UNIT = 5;
+const int HUD_MAX_QUADS = 1024;			// per frame; more are dropped
+const int HUD_GRAPH_FRAMES = 120;			// frame times in the graph
+const double HUD_GRAPH_MILLISECONDS = 50.0;	// frame time at the top of the graph
+const double HUD_REFRESH_SECONDS = 0.25;	// how often the figures are updated
+
+// 5x7 glyphs for ASCII 32..127, one byte per column, bit 0 at the top; 127 is a solid
+// block that the HUD's untextured quads sample
+const unsigned char HUD_FONT[96][5] = {
+	{ 0x00, 0x00, 0x00, 0x00, 0x00 }, { 0x00, 0x00, 0x5F, 0x00, 0x00 }, { 0x00, 0x07, 0x00, 0x07, 0x00 }, { 0x14, 0x7F, 0x14, 0x7F, 0x14 },
+	{ 0x24, 0x2A, 0x7F, 0x2A, 0x12 }, { 0x23, 0x13, 0x08, 0x64, 0x62 }, { 0x36, 0x49, 0x55, 0x22, 0x50 }, { 0x00, 0x05, 0x03, 0x00, 0x00 },
+	{ 0x00, 0x1C, 0x22, 0x41, 0x00 }, { 0x00, 0x41, 0x22, 0x1C, 0x00 }, { 0x08, 0x2A, 0x1C, 0x2A, 0x08 }, { 0x08, 0x08, 0x3E, 0x08, 0x08 },
+	{ 0x00, 0x50, 0x30, 0x00, 0x00 }, { 0x08, 0x08, 0x08, 0x08, 0x08 }, { 0x00, 0x60, 0x60, 0x00, 0x00 }, { 0x20, 0x10, 0x08, 0x04, 0x02 },
+	{ 0x3E, 0x51, 0x49, 0x45, 0x3E }, { 0x00, 0x42, 0x7F, 0x40, 0x00 }, { 0x42, 0x61, 0x51, 0x49, 0x46 }, { 0x21, 0x41, 0x45, 0x4B, 0x31 },
+	{ 0x18, 0x14, 0x12, 0x7F, 0x10 }, { 0x27, 0x45, 0x45, 0x45, 0x39 }, { 0x3C, 0x4A, 0x49, 0x49, 0x30 }, { 0x01, 0x71, 0x09, 0x05, 0x03 },
+	{ 0x36, 0x49, 0x49, 0x49, 0x36 }, { 0x06, 0x49, 0x49, 0x29, 0x1E }, { 0x00, 0x36, 0x36, 0x00, 0x00 }, { 0x00, 0x56, 0x36, 0x00, 0x00 },
+	{ 0x08, 0x14, 0x22, 0x41, 0x00 }, { 0x14, 0x14, 0x14, 0x14, 0x14 }, { 0x00, 0x41, 0x22, 0x14, 0x08 }, { 0x02, 0x01, 0x51, 0x09, 0x06 },
+	{ 0x32, 0x49, 0x79, 0x41, 0x3E }, { 0x7E, 0x11, 0x11, 0x11, 0x7E }, { 0x7F, 0x49, 0x49, 0x49, 0x36 }, { 0x3E, 0x41, 0x41, 0x41, 0x22 },
+	{ 0x7F, 0x41, 0x41, 0x22, 0x1C }, { 0x7F, 0x49, 0x49, 0x49, 0x41 }, { 0x7F, 0x09, 0x09, 0x09, 0x01 }, { 0x3E, 0x41, 0x49, 0x49, 0x7A },
+	{ 0x7F, 0x08, 0x08, 0x08, 0x7F }, { 0x00, 0x41, 0x7F, 0x41, 0x00 }, { 0x20, 0x40, 0x41, 0x3F, 0x01 }, { 0x7F, 0x08, 0x14, 0x22, 0x41 },
+	{ 0x7F, 0x40, 0x40, 0x40, 0x40 }, { 0x7F, 0x02, 0x0C, 0x02, 0x7F }, { 0x7F, 0x04, 0x08, 0x10, 0x7F }, { 0x3E, 0x41, 0x41, 0x41, 0x3E },
+	{ 0x7F, 0x09, 0x09, 0x09, 0x06 }, { 0x3E, 0x41, 0x51, 0x21, 0x5E }, { 0x7F, 0x09, 0x19, 0x29, 0x46 }, { 0x46, 0x49, 0x49, 0x49, 0x31 },
+	{ 0x01, 0x01, 0x7F, 0x01, 0x01 }, { 0x3F, 0x40, 0x40, 0x40, 0x3F }, { 0x1F, 0x20, 0x40, 0x20, 0x1F }, { 0x3F, 0x40, 0x38, 0x40, 0x3F },
+	{ 0x63, 0x14, 0x08, 0x14, 0x63 }, { 0x07, 0x08, 0x70, 0x08, 0x07 }, { 0x61, 0x51, 0x49, 0x45, 0x43 }, { 0x00, 0x7F, 0x41, 0x41, 0x00 },
+	{ 0x02, 0x04, 0x08, 0x10, 0x20 }, { 0x00, 0x41, 0x41, 0x7F, 0x00 }, { 0x04, 0x02, 0x01, 0x02, 0x04 }, { 0x40, 0x40, 0x40, 0x40, 0x40 },
+	{ 0x00, 0x01, 0x02, 0x04, 0x00 }, { 0x20, 0x54, 0x54, 0x54, 0x78 }, { 0x7F, 0x48, 0x44, 0x44, 0x38 }, { 0x38, 0x44, 0x44, 0x44, 0x20 },
+	{ 0x38, 0x44, 0x44, 0x48, 0x7F }, { 0x38, 0x54, 0x54, 0x54, 0x18 }, { 0x08, 0x7E, 0x09, 0x01, 0x02 }, { 0x0C, 0x52, 0x52, 0x52, 0x3E },
+	{ 0x7F, 0x08, 0x04, 0x04, 0x78 }, { 0x00, 0x44, 0x7D, 0x40, 0x00 }, { 0x20, 0x40, 0x44, 0x3D, 0x00 }, { 0x7F, 0x10, 0x28, 0x44, 0x00 },
+	{ 0x00, 0x41, 0x7F, 0x40, 0x00 }, { 0x7C, 0x04, 0x18, 0x04, 0x78 }, { 0x7C, 0x08, 0x04, 0x04, 0x78 }, { 0x38, 0x44, 0x44, 0x44, 0x38 },
+	{ 0x7C, 0x14, 0x14, 0x14, 0x08 }, { 0x08, 0x14, 0x14, 0x18, 0x7C }, { 0x7C, 0x08, 0x04, 0x04, 0x08 }, { 0x48, 0x54, 0x54, 0x54, 0x20 },
+	{ 0x04, 0x3F, 0x44, 0x40, 0x20 }, { 0x3C, 0x40, 0x40, 0x20, 0x7C }, { 0x1C, 0x20, 0x40, 0x20, 0x1C }, { 0x3C, 0x40, 0x30, 0x40, 0x3C },
+	{ 0x44, 0x28, 0x10, 0x28, 0x44 }, { 0x0C, 0x50, 0x50, 0x50, 0x3C }, { 0x44, 0x64, 0x54, 0x4C, 0x44 }, { 0x00, 0x08, 0x36, 0x41, 0x00 },
+	{ 0x00, 0x00, 0x7F, 0x00, 0x00 }, { 0x00, 0x41, 0x36, 0x08, 0x00 }, { 0x08, 0x04, 0x08, 0x10, 0x08 }, { 0x7F, 0x7F, 0x7F, 0x7F, 0x7F }
+};
+// atlas layout: 16 x 6 cells of 6 x 8 texels (a glyph plus one texel of spacing)
+const int HUD_FONT_COLUMNS = 16;
+const int HUD_CELL_WIDTH = 6;
+const int HUD_CELL_HEIGHT = 8;
+const int HUD_ATLAS_WIDTH = HUD_FONT_COLUMNS * HUD_CELL_WIDTH;
+const int HUD_ATLAS_HEIGHT = 6 * HUD_CELL_HEIGHT;
+
+struct HudColour {
+	unsigned char r, g, b, a;
+};
+
+// what one corner of a HUD quad carries: pixels from the top left, atlas coordinates, colour
+struct HudVertex {
+	float x, y;
+	float u, v;
+	HudColour colour;
+};
+
+// resident memory of the whole process in bytes, 0 where it cannot be asked for
+inline size_t processMemoryBytes() {
+#ifdef _WIN32
+	HudProcessMemoryCounters counters = {};
+	counters.cb = sizeof(counters);
+	if (K32GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+		return counters.workingSetSize;
+	return 0;
+#elif defined(__linux__)
+	std::ifstream statm("/proc/self/statm");
+	size_t pages = 0, resident = 0;
+	if (!(statm >> pages >> resident))
+		return 0;
+	return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#else
+	return 0;
+#endif
+}
+
+// On-screen performance overlay: frame rate and frame time with a graph of the last
+// HUD_GRAPH_FRAMES frames, the draw calls, triangles and state changes the scene's
+// replays submitted, what occlusion culling hid, and memory. Text and graph are built
+// on the CPU as quads of one vertex format (solid quads sample an opaque glyph of the
+// font atlas), streamed into one buffer and drawn with a single glDrawElements, so the
+// HUD adds one program, one texture and one draw call to the frame. The figures are
+// averaged and refreshed every HUD_REFRESH_SECONDS so they can be read; the graph moves
+// every frame. The HUD times itself and shows that too.
+class PerformanceHud {
+
+public:
+	Shader shader;
+	std::string vertexPath, fragmentPath;
+	int scale;				// screen pixels per font texel
+	size_t geometryBytes;	// vertex and index data of the scene's meshes, set by main
+	double costMilliseconds;	// CPU time of draw(), averaged over the last refresh
+
+	// needs a current context, like the renderer
+	PerformanceHud(const char* vertexPath, const char* fragmentPath, ShaderCache* cache = NULL)
+		: shader(vertexPath, fragmentPath, cache), vertexPath(vertexPath), fragmentPath(fragmentPath), scale(2), geometryBytes(0),
+		costMilliseconds(0.0), fontTexture(0), VAO(0), VBO(0), EBO(0), nextSample(0), intervalFrames(0), intervalMilliseconds(0.0),
+		intervalWorst(0.0), intervalCost(0.0), intervalDraws(0), lineCount(0) {
+		std::fill(frameMilliseconds, frameMilliseconds + HUD_GRAPH_FRAMES, 0.0f);
+	}
+
+	void init() {
+		// the font atlas: one coverage byte per texel
+		std::vector<unsigned char> atlas(HUD_ATLAS_WIDTH * HUD_ATLAS_HEIGHT, 0);
+		for (int glyph = 0; glyph < 96; glyph++) {
+			int cellX = (glyph % HUD_FONT_COLUMNS) * HUD_CELL_WIDTH, cellY = (glyph / HUD_FONT_COLUMNS) * HUD_CELL_HEIGHT;
+			for (int column = 0; column < 5; column++)
+				for (int row = 0; row < 7; row++)
+					if (HUD_FONT[glyph][column] & (1 << row))
+						atlas[(cellY + row) * HUD_ATLAS_WIDTH + cellX + column] = 255;
+		}
+		glGenTextures(1, &fontTexture);
+		glBindTexture(GL_TEXTURE_2D, fontTexture);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, HUD_ATLAS_WIDTH, HUD_ATLAS_HEIGHT, 0, GL_RED, GL_UNSIGNED_BYTE, atlas.data());
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		// every quad is two triangles of its four corners; the indices never change
+		std::vector<unsigned short> indices(HUD_MAX_QUADS * 6);
+		for (int q = 0; q < HUD_MAX_QUADS; q++) {
+			unsigned short corner = static_cast<unsigned short>(q * 4);
+			unsigned short quad[6] = { corner, static_cast<unsigned short>(corner + 1), static_cast<unsigned short>(corner + 2),
+				static_cast<unsigned short>(corner + 2), static_cast<unsigned short>(corner + 3), corner };
+			std::copy(quad, quad + 6, &indices[q * 6]);
+		}
+		vertices.reserve(HUD_MAX_QUADS * 4);
+		glGenVertexArrays(1, &VAO);
+		glGenBuffers(1, &VBO);
+		glGenBuffers(1, &EBO);
+		glBindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, HUD_MAX_QUADS * 4 * sizeof(HudVertex), NULL, GL_STREAM_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned short), indices.data(), GL_STATIC_DRAW);
+		glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(HudVertex), (void*)0);
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(HudVertex), (void*)(2 * sizeof(float)));
+		glEnableVertexAttribArray(1);
+		glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(HudVertex), (void*)(4 * sizeof(float)));
+		glEnableVertexAttribArray(2);
+		glBindVertexArray(0);
+		lastFrame = lastRefresh = Clock::now();
+	}
+	void release() {
+		glDeleteTextures(1, &fontTexture);
+		glDeleteVertexArrays(1, &VAO);
+		glDeleteBuffers(1, &VBO);
+		glDeleteBuffers(1, &EBO);
+		fontTexture = VAO = VBO = EBO = 0;
+	}
+
+	// once per rendered frame, shown or not, so the graph has a history when the HUD is turned on
+	void frame() {
+		Clock::time_point now = Clock::now();
+		float milliseconds = std::chrono::duration<float, std::milli>(now - lastFrame).count();
+		lastFrame = now;
+		frameMilliseconds[nextSample] = milliseconds;
+		nextSample = (nextSample + 1) % HUD_GRAPH_FRAMES;
+		intervalFrames++;
+		intervalMilliseconds += milliseconds;
+		intervalWorst = std::max(intervalWorst, static_cast<double>(milliseconds));
+	}
+
+	// over the frame just rendered, into the bound framebuffer; call after the scene's passes
+	void draw(const Viewport& viewport, const RenderQueue& scene, const OcclusionCuller& occlusion) {
+		TRACE_SCOPE("hud");
+		Clock::time_point start = Clock::now();
+		if (std::chrono::duration<double>(start - lastRefresh).count() >= HUD_REFRESH_SECONDS)
+			refresh(start, scene, occlusion);
+
+		const HudColour panel = { 0, 0, 0, 160 }, text = { 235, 235, 235, 255 };
+		const HudColour good = { 90, 220, 90, 255 }, slow = { 240, 200, 60, 255 }, bad = { 240, 70, 60, 255 }, guide = { 255, 255, 255, 90 };
+		float margin = 4.0f * scale, lineHeight = static_cast<float>(HUD_CELL_HEIGHT * scale);
+		float graphWidth = static_cast<float>(HUD_GRAPH_FRAMES * scale), graphHeight = 32.0f * scale;
+		float textWidth = 0.0f;
+		for (int l = 0; l < lineCount; l++)
+			textWidth = std::max(textWidth, static_cast<float>(strlen(lines[l]) * HUD_CELL_WIDTH * scale));
+		float width = std::max(textWidth, graphWidth) + 2.0f * margin;
+		float height = lineCount * lineHeight + graphHeight + 3.0f * margin;
+
+		vertices.clear();
+		solid(0.0f, 0.0f, width, height, panel);
+		for (int l = 0; l < lineCount; l++)
+			label(margin, margin + l * lineHeight, lines[l], text);
+
+		// frame times, oldest on the left, with guides at 60 and 30 frames per second
+		float graphTop = margin * 2.0f + lineCount * lineHeight, graphBottom = graphTop + graphHeight;
+		for (int f = 0; f < HUD_GRAPH_FRAMES; f++) {
+			float milliseconds = frameMilliseconds[(nextSample + f) % HUD_GRAPH_FRAMES];
+			float bar = std::min(1.0f, static_cast<float>(milliseconds / HUD_GRAPH_MILLISECONDS)) * graphHeight;
+			float x = margin + f * scale;
+			solid(x, graphBottom - bar, x + scale, graphBottom, milliseconds <= 1000.0f / 58.0f ? good : milliseconds <= 1000.0f / 29.0f ? slow : bad);
+		}
+		const double guides[2] = { 1000.0 / 60.0, 1000.0 / 30.0 };
+		for (int g = 0; g < 2; g++) {
+			float y = graphBottom - static_cast<float>(guides[g] / HUD_GRAPH_MILLISECONDS) * graphHeight;
+			solid(margin, y, margin + graphWidth, y + 1.0f, guide);
+		}
+
+		// one stream upload and one draw, blended over the frame
+		glDisable(GL_DEPTH_TEST);
+		glEnable(GL_BLEND);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		shader.use();
+		shader.setVec2("screenSize", static_cast<float>(viewport.width), static_cast<float>(viewport.height));
+		shader.setInt("font", HUD_FONT_TEXTURE_UNIT);
+		glActiveTexture(GL_TEXTURE0 + HUD_FONT_TEXTURE_UNIT);
+		glBindTexture(GL_TEXTURE_2D, fontTexture);
+		glActiveTexture(GL_TEXTURE0);
+		glBindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		// orphaning: the GPU may still be drawing last frame's quads
+		glBufferData(GL_ARRAY_BUFFER, HUD_MAX_QUADS * 4 * sizeof(HudVertex), NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, vertices.size() * sizeof(HudVertex), vertices.data());
+		glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(vertices.size() / 4 * 6), GL_UNSIGNED_SHORT, 0);
+		glBindVertexArray(0);
+		glDisable(GL_BLEND);
+		glEnable(GL_DEPTH_TEST);
+
+		intervalCost += std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+		intervalDraws++;
+	}
+
+private:
+	typedef std::chrono::steady_clock Clock;
+
+	unsigned int fontTexture, VAO, VBO, EBO;
+	std::vector<HudVertex> vertices;
+	float frameMilliseconds[HUD_GRAPH_FRAMES];	// ring buffer
+	int nextSample;
+	Clock::time_point lastFrame, lastRefresh;
+	// accumulated since the last refresh
+	int intervalFrames;
+	double intervalMilliseconds, intervalWorst, intervalCost;
+	int intervalDraws;
+	char lines[5][64];
+	int lineCount;
+
+	// the text, from the averages of the interval that just ended and the latest counts
+	void refresh(Clock::time_point now, const RenderQueue& scene, const OcclusionCuller& occlusion) {
+		double average = intervalFrames ? intervalMilliseconds / intervalFrames : 0.0;
+		costMilliseconds = intervalDraws ? intervalCost / intervalDraws : 0.0;
+		const RenderStats& stats = scene.stats;
+		lineCount = 0;
+		snprintf(lines[lineCount++], sizeof(lines[0]), "%5.1f fps %6.2f ms  worst %6.2f", average > 0.0 ? 1000.0 / average : 0.0, average, intervalWorst);
+		snprintf(lines[lineCount++], sizeof(lines[0]), "draws %d  tris %.1fk  states %d", stats.drawCalls, stats.triangles / 1000.0, stats.stateChanges);
+		if (occlusion.enabled)
+			snprintf(lines[lineCount++], sizeof(lines[0]), "culled %d/%d groups, %d/%d draws", occlusion.hiddenGroups, static_cast<int>(scene.groups.size()),
+				occlusion.hiddenDraws, static_cast<int>(scene.items.size()));
+		else
+			snprintf(lines[lineCount++], sizeof(lines[0]), "culled -, occlusion off");
+		snprintf(lines[lineCount++], sizeof(lines[0]), "memory %.1f MB  meshes %.2f MB", processMemoryBytes() / 1048576.0, geometryBytes / 1048576.0);
+		snprintf(lines[lineCount++], sizeof(lines[0]), "hud %.3f ms", costMilliseconds);
+		intervalFrames = 0;
+		intervalMilliseconds = intervalWorst = intervalCost = 0.0;
+		intervalDraws = 0;
+		lastRefresh = now;
+	}
+
+	void quad(float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1, HudColour colour) {
+		if (vertices.size() >= static_cast<size_t>(HUD_MAX_QUADS) * 4)
+			return;
+		HudVertex corners[4] = { { x0, y0, u0, v0, colour }, { x1, y0, u1, v0, colour }, { x1, y1, u1, v1, colour }, { x0, y1, u0, v1, colour } };
+		vertices.insert(vertices.end(), corners, corners + 4);
+	}
+	// untextured: every corner samples the middle of the solid glyph
+	void solid(float x0, float y0, float x1, float y1, HudColour colour) {
+		const int glyph = 127 - 32;
+		float u = ((glyph % HUD_FONT_COLUMNS) * HUD_CELL_WIDTH + 2.5f) / HUD_ATLAS_WIDTH;
+		float v = ((glyph / HUD_FONT_COLUMNS) * HUD_CELL_HEIGHT + 3.5f) / HUD_ATLAS_HEIGHT;
+		quad(x0, y0, x1, y1, u, v, u, v, colour);
+	}
+	void label(float x, float y, const char* text, HudColour colour) {
+		for (; *text; text++, x += HUD_CELL_WIDTH * scale) {
+			int c = static_cast<unsigned char>(*text);
+			if (c == ' ')
+				continue;
+			int glyph = (c > 32 && c < 127 ? c : '?') - 32;
+			float u = static_cast<float>((glyph % HUD_FONT_COLUMNS) * HUD_CELL_WIDTH), v = static_cast<float>((glyph / HUD_FONT_COLUMNS) * HUD_CELL_HEIGHT);
+			quad(x, y, x + 5.0f * scale, y + 7.0f * scale, u / HUD_ATLAS_WIDTH, v / HUD_ATLAS_HEIGHT, (u + 5.0f) / HUD_ATLAS_WIDTH, (v + 7.0f) / HUD_ATLAS_HEIGHT, colour);
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,17 @@
+#version 330 core
+// the performance HUD (hud.h): screen-space quads in pixels, origin at the top left
+layout (location = 0) in vec2 aPos;
+layout (location = 1) in vec2 aTexCoord;
+layout (location = 2) in vec4 aColor;
+
+out vec2 TexCoord;
+out vec4 Color;
+
+uniform vec2 screenSize;
+
+void main()
+{
+    gl_Position = vec4(aPos.x / screenSize.x * 2.0 - 1.0, 1.0 - aPos.y / screenSize.y * 2.0, 0.0, 1.0);
+    TexCoord = aTexCoord;
+    Color = aColor;
+}
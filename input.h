@@ -0,0 +1,174 @@
+#pragma once
+#ifndef input_h
+#define input_h
+
+#include "spsc_queue.h"
+#include <GLFW/glfw3.h>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Everything the keyboard can do, independent of which key is bound to it
+enum Input_Action {
+	ACTION_FORWARD,
+	ACTION_BACKWARD,
+	ACTION_LEFT,
+	ACTION_RIGHT,
+	ACTION_UP,
+	ACTION_DOWN,
+	ACTION_PITCH_UP,
+	ACTION_PITCH_DOWN,
+	ACTION_YAW_LEFT,
+	ACTION_YAW_RIGHT,
+	ACTION_ROLL_LEFT,
+	ACTION_ROLL_RIGHT,
+	ACTION_TOGGLE_FAN,
+	ACTION_TOGGLE_ORBIT,
+	ACTION_TOGGLE_PREPASS,
+	ACTION_TOGGLE_OCCLUSION,
+	ACTION_TOGGLE_HUD,
+	ACTION_DUMP_TRACE,
+	ACTION_QUIT,
+	ACTION_COUNT
+};
+
+// names used by binding files, in Input_Action order
+const char* const ACTION_NAMES[ACTION_COUNT] = {
+	"forward", "backward", "left", "right", "up", "down",
+	"pitch_up", "pitch_down", "yaw_left", "yaw_right", "roll_left", "roll_right",
+	"toggle_fan", "toggle_orbit", "toggle_prepass", "toggle_occlusion", "toggle_hud", "dump_trace", "quit"
+};
+
+struct KeyEvent {
+	int key;
+	int action;	// GLFW_PRESS or GLFW_RELEASE
+};
+
+// Keyboard state built from glfwSetKeyCallback events instead of polling glfwGetKey.
+// The callback only pushes into a lock-free queue; beginFrame() drains it once per
+// frame and derives per-key edges, so a toggle flips exactly once per key press no
+// matter how many frames the key is held, and a tap shorter than a frame still counts.
+class Input {
+
+public:
+	Input() {
+		memset(down, 0, sizeof(down));
+		memset(pressed, 0, sizeof(pressed));
+		memset(released, 0, sizeof(released));
+		bindings[ACTION_FORWARD] = GLFW_KEY_W;
+		bindings[ACTION_BACKWARD] = GLFW_KEY_S;
+		bindings[ACTION_LEFT] = GLFW_KEY_A;
+		bindings[ACTION_RIGHT] = GLFW_KEY_D;
+		bindings[ACTION_UP] = GLFW_KEY_E;
+		bindings[ACTION_DOWN] = GLFW_KEY_R;
+		bindings[ACTION_PITCH_UP] = GLFW_KEY_X;
+		bindings[ACTION_PITCH_DOWN] = GLFW_KEY_C;
+		bindings[ACTION_YAW_LEFT] = GLFW_KEY_Y;
+		bindings[ACTION_YAW_RIGHT] = GLFW_KEY_V;
+		bindings[ACTION_ROLL_LEFT] = GLFW_KEY_Z;
+		bindings[ACTION_ROLL_RIGHT] = GLFW_KEY_Q;
+		bindings[ACTION_TOGGLE_FAN] = GLFW_KEY_G;
+		bindings[ACTION_TOGGLE_ORBIT] = GLFW_KEY_F;
+		bindings[ACTION_TOGGLE_PREPASS] = GLFW_KEY_P;
+		bindings[ACTION_TOGGLE_OCCLUSION] = GLFW_KEY_O;
+		bindings[ACTION_TOGGLE_HUD] = GLFW_KEY_H;
+		bindings[ACTION_DUMP_TRACE] = GLFW_KEY_T;
+		bindings[ACTION_QUIT] = GLFW_KEY_ESCAPE;
+	}
+
+	// called from the GLFW key callback
+	void onKey(int key, int action) {
+		if (key < 0 || key > GLFW_KEY_LAST || action == GLFW_REPEAT)
+			return;
+		KeyEvent event = { key, action };
+		if (!events.push(event))
+			std::cout << "INPUT::EVENT_QUEUE_FULL: key " << key << " dropped" << std::endl;
+	}
+
+	// drains this frame's events; call once per frame before querying
+	void beginFrame() {
+		for (int key : touched) {
+			pressed[key] = 0;
+			released[key] = 0;
+		}
+		touched.clear();
+
+		KeyEvent event;
+		while (events.pop(event)) {
+			if (event.action == GLFW_PRESS) {
+				if (!down[event.key])
+					pressed[event.key] = 1;
+				down[event.key] = 1;
+			}
+			else {
+				if (down[event.key])
+					released[event.key] = 1;
+				down[event.key] = 0;
+			}
+			touched.push_back(event.key);
+		}
+	}
+
+	bool isDown(Input_Action action) const {
+		return down[bindings[action]] != 0;
+	}
+	bool wasPressed(Input_Action action) const {
+		return pressed[bindings[action]] != 0;
+	}
+	bool wasReleased(Input_Action action) const {
+		return released[bindings[action]] != 0;
+	}
+	// true while any key is held, changed this frame or has events waiting
+	bool active() const {
+		if (!touched.empty() || !events.empty())
+			return true;
+		for (int action = 0; action < ACTION_COUNT; action++)
+			if (down[bindings[action]])
+				return true;
+		return false;
+	}
+
+	void bind(Input_Action action, int key) {
+		if (key >= 0 && key <= GLFW_KEY_LAST)
+			bindings[action] = key;
+	}
+	int binding(Input_Action action) const {
+		return bindings[action];
+	}
+
+	// reads "<action> <key>" lines, e.g. "toggle_fan G" or "quit 256" (a GLFW key code);
+	// a missing file keeps the defaults
+	bool loadBindings(const char* path) {
+		std::ifstream file(path);
+		if (!file)
+			return false;
+		std::string name, key;
+		while (file >> name >> key) {
+			int code = key.size() == 1 ? toupper(key[0]) : atoi(key.c_str());
+			bool known = false;
+			for (int action = 0; action < ACTION_COUNT; action++) {
+				if (name == ACTION_NAMES[action]) {
+					bind(static_cast<Input_Action>(action), code);
+					known = true;
+				}
+			}
+			if (!known)
+				std::cout << "INPUT::UNKNOWN_ACTION: " << name << std::endl;
+		}
+		return true;
+	}
+
+private:
+	SpscQueue<KeyEvent, 256> events;
+	unsigned char down[GLFW_KEY_LAST + 1];
+	unsigned char pressed[GLFW_KEY_LAST + 1];
+	unsigned char released[GLFW_KEY_LAST + 1];
+	std::vector<int> touched;	// keys whose edges must be cleared next frame
+	int bindings[ACTION_COUNT];
+};
+
+#endif
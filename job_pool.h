@@ -0,0 +1,110 @@
+#pragma once
+#ifndef job_pool_h
+#define job_pool_h
+
+#include "trace.h"
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A small set of persistent worker threads for splitting per-frame CPU work
+// (light binning, ...) into independent jobs. run() hands out job indices
+// through an atomic counter, works on them from the calling thread as well and
+// returns once every job has finished. Without start() everything runs inline.
+class JobPool {
+
+public:
+	JobPool() : job(NULL), jobCount(0), next(0), busy(0), generation(0), quitting(false) {
+	}
+	~JobPool() {
+		stop();
+	}
+
+	// spawns 'workers' threads; by default one less than the hardware threads, leaving the caller's
+	static int defaultWorkers() {
+		int hardware = static_cast<int>(std::thread::hardware_concurrency());
+		return hardware > 1 ? hardware - 1 : 0;
+	}
+	void start(int workers = defaultWorkers()) {
+		stop();
+		quitting = false;
+		for (int i = 0; i < workers; i++)
+			threads.push_back(std::thread(&JobPool::worker, this));
+	}
+	void stop() {
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			quitting = true;
+		}
+		wake.notify_all();
+		for (size_t i = 0; i < threads.size(); i++)
+			threads[i].join();
+		threads.clear();
+	}
+
+	int threadCount() const {
+		return static_cast<int>(threads.size()) + 1;
+	}
+
+	// calls task(i) for every i in [0, count) and waits for all of them
+	void run(int count, const std::function<void(int)>& task) {
+		if (threads.empty() || count <= 1) {
+			for (int i = 0; i < count; i++)
+				task(i);
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(mutex);
+			job = &task;
+			jobCount = count;
+			next.store(0);
+			busy = static_cast<int>(threads.size());
+			generation++;
+		}
+		wake.notify_all();
+		work();
+		std::unique_lock<std::mutex> lock(mutex);
+		done.wait(lock, [this] { return busy == 0; });
+		job = NULL;
+	}
+
+private:
+	std::vector<std::thread> threads;
+	std::mutex mutex;
+	std::condition_variable wake, done;
+	const std::function<void(int)>* job;
+	int jobCount;
+	std::atomic<int> next;
+	int busy;				// workers still inside the current generation
+	unsigned int generation;
+	bool quitting;
+
+	void work() {
+		TRACE_SCOPE("jobs");
+		for (int i = next.fetch_add(1); i < jobCount; i = next.fetch_add(1))
+			(*job)(i);
+	}
+
+	void worker() {
+		Tracer::instance().nameThread("worker");
+		unsigned int seen = 0;
+		for (;;) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				wake.wait(lock, [&] { return quitting || generation != seen; });
+				if (quitting)
+					return;
+				seen = generation;
+			}
+			work();
+			std::lock_guard<std::mutex> lock(mutex);
+			if (--busy == 0)
+				done.notify_one();
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,362 @@
+#pragma once
+#ifndef lighting_h
+#define lighting_h
+
+#include "shader.h"
+#include "viewport.h"
+#include "job_pool.h"
+#include "trace.h"
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LIGHTING_SSE 1
+#include <emmintrin.h>
+#endif
+
+// lights the clusters can index (the light data itself lives in a texture buffer)
+const int MAX_LIGHTS = 1024;
+// froxel grid: screen tiles across, down, and exponential depth slices
+const int CLUSTER_X = 16;
+const int CLUSTER_Y = 9;
+const int CLUSTER_Z = 24;
+const int CLUSTER_COUNT = CLUSTER_X * CLUSTER_Y * CLUSTER_Z;
+// lights kept per cluster; further lights touching a full cluster are dropped
+const int MAX_LIGHTS_PER_CLUSTER = 256;
+// texture units used by the lighting pass
+const int LIGHT_DATA_TEXTURE_UNIT = 1;
+const int CLUSTER_LIGHTS_TEXTURE_UNIT = 2;
+const int LIGHT_INDICES_TEXTURE_UNIT = 3;
+
+// A point light with a finite range: it contributes nothing beyond 'radius'
+struct PointLight {
+	glm::vec3 position;
+	float radius;
+	glm::vec3 color;
+	float intensity;
+	int shadowLayer = -1;	// layer in ShadowMaps, -1 for lights without shadows
+};
+
+// Owns the scene's point lights and bins them into a clustered (froxel) grid every
+// frame: the view frustum is cut into CLUSTER_X x CLUSTER_Y screen tiles and CLUSTER_Z
+// slices spaced exponentially in depth, each light is tested against the view-space
+// boxes of the clusters its sphere can touch, and the per-cluster light lists are
+// uploaded as texture buffers, so a fragment only loops over the lights that can
+// reach its cluster. Slices are binned in parallel on a JobPool and the sphere/box
+// tests run four clusters at a time with SSE.
+class Lighting {
+
+public:
+	std::vector<PointLight> lights;
+	glm::vec3 ambientColor;
+
+	// statistics of the last cull()
+	int visibleLights;
+	int clusterLightPairs;
+	double cullMilliseconds;
+
+	Lighting() : ambientColor(1.0f), visibleLights(0), clusterLightPairs(0), cullMilliseconds(0.0),
+		lightsDirty(true), gridWidth(0), gridHeight(0), gridProjection(0.0f) {
+		for (int i = 0; i < 3; i++)
+			buffers[i] = textures[i] = 0;
+	}
+
+	// creates the GL objects and the binning threads; needs a current context
+	void init() {
+		glGenBuffers(3, buffers);
+		glGenTextures(3, textures);
+		// light data: three RGBA32F texels per light, cluster ranges: (offset, count) pairs, indices: one uint each
+		const GLenum formats[3] = { GL_RGBA32F, GL_RG32UI, GL_R32UI };
+		for (int i = 0; i < 3; i++) {
+			glBindBuffer(GL_TEXTURE_BUFFER, buffers[i]);
+			glBufferData(GL_TEXTURE_BUFFER, sizeof(glm::vec4) * 2, NULL, GL_STREAM_DRAW);
+			glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+			glTexBuffer(GL_TEXTURE_BUFFER, formats[i], buffers[i]);
+		}
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+		glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+		clusterCounts.assign(CLUSTER_COUNT, 0);
+		clusterItems.resize(CLUSTER_COUNT * MAX_LIGHTS_PER_CLUSTER);
+		jobs.start();
+	}
+
+	void release() {
+		jobs.stop();
+		glDeleteBuffers(3, buffers);
+		glDeleteTextures(3, textures);
+	}
+
+	int add(const PointLight& light) {
+		if (static_cast<int>(lights.size()) >= MAX_LIGHTS) {
+			std::cout << "LIGHTING::TOO_MANY_LIGHTS: only " << MAX_LIGHTS << " point lights are supported" << std::endl;
+			return -1;
+		}
+		lights.push_back(light);
+		lightsDirty = true;
+		return static_cast<int>(lights.size()) - 1;
+	}
+	// call after editing 'lights' directly
+	void markDirty() {
+		lightsDirty = true;
+	}
+
+	// bins the lights into clusters for this frame's camera and uploads the lists
+	void cull(const glm::mat4& view, const glm::mat4& projection, const Viewport& viewport) {
+		TRACE_SCOPE("light culling");
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		if (lightsDirty)
+			uploadLights();
+		if (viewport.width != gridWidth || viewport.height != gridHeight || projection != gridProjection)
+			buildGrid(projection, viewport);
+
+		// per light: view-space sphere and the block of clusters it can touch
+		candidates.clear();
+		for (int l = 0; l < static_cast<int>(lights.size()); l++) {
+			Candidate c;
+			if (clusterRange(lights[l], view, projection, c)) {
+				c.light = l;
+				candidates.push_back(c);
+			}
+		}
+		visibleLights = static_cast<int>(candidates.size());
+
+		// every slice owns its clusters, so the slices bin in parallel without locking
+		jobs.run(CLUSTER_Z, [this](int z) { binSlice(z); });
+
+		// prefix sum into (offset, count) ranges and compact the per-cluster lists
+		clusterRanges.resize(CLUSTER_COUNT * 2);
+		unsigned int offset = 0;
+		for (int c = 0; c < CLUSTER_COUNT; c++) {
+			clusterRanges[c * 2] = offset;
+			clusterRanges[c * 2 + 1] = clusterCounts[c];
+			offset += clusterCounts[c];
+		}
+		clusterLightPairs = static_cast<int>(offset);
+		lightIndices.resize(std::max(1u, offset));
+		for (int c = 0; c < CLUSTER_COUNT; c++)
+			std::copy(&clusterItems[c * MAX_LIGHTS_PER_CLUSTER], &clusterItems[c * MAX_LIGHTS_PER_CLUSTER] + clusterCounts[c], &lightIndices[clusterRanges[c * 2]]);
+
+		// orphan and refill: the GPU may still be reading last frame's lists
+		glBindBuffer(GL_TEXTURE_BUFFER, buffers[1]);
+		glBufferData(GL_TEXTURE_BUFFER, clusterRanges.size() * sizeof(unsigned int), clusterRanges.data(), GL_STREAM_DRAW);
+		glBindBuffer(GL_TEXTURE_BUFFER, buffers[2]);
+		glBufferData(GL_TEXTURE_BUFFER, lightIndices.size() * sizeof(unsigned int), lightIndices.data(), GL_STREAM_DRAW);
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+		cullMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// binds the light lists and sets the per-frame lighting uniforms
+	void apply(const Shader& shader, const glm::vec3& viewPos, const Viewport& viewport) const {
+		for (int i = 0; i < 3; i++) {
+			glActiveTexture(GL_TEXTURE0 + LIGHT_DATA_TEXTURE_UNIT + i);
+			glBindTexture(GL_TEXTURE_BUFFER, textures[i]);
+		}
+		glActiveTexture(GL_TEXTURE0);
+		// set every frame: the program may be a variant just built or reloaded
+		shader.setInt("lightData", LIGHT_DATA_TEXTURE_UNIT);
+		shader.setInt("clusterLights", CLUSTER_LIGHTS_TEXTURE_UNIT);
+		shader.setInt("lightIndices", LIGHT_INDICES_TEXTURE_UNIT);
+		shader.setVec2("clusterTileSize", tileWidth, tileHeight);
+		shader.setFloat("clusterNear", viewport.nearPlane);
+		shader.setFloat("clusterFar", viewport.farPlane);
+		shader.setFloat("sliceScale", sliceScale);
+		shader.setFloat("sliceBias", sliceBias);
+		shader.setVec3("ambientColor", ambientColor);
+		shader.setVec3("viewPos", viewPos);
+	}
+
+private:
+	// a visible light: view-space sphere and its cluster block (inclusive)
+	struct Candidate {
+		int light;
+		float x, y, z, radius;
+		int x0, y0, z0, x1, y1, z1;
+	};
+
+	unsigned int buffers[3];
+	unsigned int textures[3];
+	bool lightsDirty;
+	JobPool jobs;
+
+	// cluster boxes in view space, structure of arrays indexed (z * CLUSTER_Y + y) * CLUSTER_X + x
+	std::vector<float> boxMin[3], boxMax[3];
+	int gridWidth, gridHeight;
+	glm::mat4 gridProjection;
+	float tileWidth, tileHeight;		// pixels per cluster tile
+	float sliceScale, sliceBias;		// slice = log(depth) * sliceScale + sliceBias
+	float nearPlane, farPlane;
+
+	std::vector<Candidate> candidates;
+	std::vector<unsigned int> clusterCounts;
+	std::vector<unsigned int> clusterItems;	// MAX_LIGHTS_PER_CLUSTER slots per cluster
+	std::vector<unsigned int> clusterRanges;
+	std::vector<unsigned int> lightIndices;
+
+	void uploadLights() {
+		std::vector<glm::vec4> data(std::max<size_t>(1, lights.size()) * 3, glm::vec4(0.0f));
+		for (size_t l = 0; l < lights.size(); l++) {
+			data[l * 3] = glm::vec4(lights[l].position, lights[l].radius);
+			data[l * 3 + 1] = glm::vec4(lights[l].color, lights[l].intensity);
+			data[l * 3 + 2] = glm::vec4(static_cast<float>(lights[l].shadowLayer), 0.0f, 0.0f, 0.0f);
+		}
+		glBindBuffer(GL_TEXTURE_BUFFER, buffers[0]);
+		glBufferData(GL_TEXTURE_BUFFER, data.size() * sizeof(glm::vec4), &data[0][0], GL_STATIC_DRAW);
+		glBindBuffer(GL_TEXTURE_BUFFER, 0);
+		lightsDirty = false;
+	}
+
+	// view-space depth (positive) of the boundary before slice z
+	float sliceDepth(int z) const {
+		return nearPlane * std::pow(farPlane / nearPlane, static_cast<float>(z) / CLUSTER_Z);
+	}
+	int sliceOf(float depth) const {
+		return glm::clamp(static_cast<int>(std::floor(std::log(depth) * sliceScale + sliceBias)), 0, CLUSTER_Z - 1);
+	}
+
+	// recomputes the cluster boxes; only needed when the projection or framebuffer changes
+	void buildGrid(const glm::mat4& projection, const Viewport& viewport) {
+		gridWidth = viewport.width;
+		gridHeight = viewport.height;
+		gridProjection = projection;
+		nearPlane = viewport.nearPlane;
+		farPlane = viewport.farPlane;
+		tileWidth = std::ceil(static_cast<float>(std::max(1, gridWidth)) / CLUSTER_X);
+		tileHeight = std::ceil(static_cast<float>(std::max(1, gridHeight)) / CLUSTER_Y);
+		sliceScale = CLUSTER_Z / std::log(farPlane / nearPlane);
+		sliceBias = -CLUSTER_Z * std::log(nearPlane) / std::log(farPlane / nearPlane);
+
+		// view-space rays through the tile corners, scaled so that -z == 1
+		glm::mat4 inverseProjection = glm::inverse(projection);
+		std::vector<glm::vec3> rays((CLUSTER_X + 1) * (CLUSTER_Y + 1));
+		for (int y = 0; y <= CLUSTER_Y; y++) {
+			for (int x = 0; x <= CLUSTER_X; x++) {
+				float ndcX = std::min(x * tileWidth / std::max(1, gridWidth), 1.0f) * 2.0f - 1.0f;
+				float ndcY = std::min(y * tileHeight / std::max(1, gridHeight), 1.0f) * 2.0f - 1.0f;
+				glm::vec4 p = inverseProjection * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+				glm::vec3 ray = glm::vec3(p) / p.w;
+				rays[y * (CLUSTER_X + 1) + x] = ray / -ray.z;
+			}
+		}
+		for (int k = 0; k < 3; k++) {
+			boxMin[k].resize(CLUSTER_COUNT);
+			boxMax[k].resize(CLUSTER_COUNT);
+		}
+		for (int z = 0; z < CLUSTER_Z; z++) {
+			float depths[2] = { sliceDepth(z), sliceDepth(z + 1) };
+			for (int y = 0; y < CLUSTER_Y; y++) {
+				for (int x = 0; x < CLUSTER_X; x++) {
+					glm::vec3 lo(1e30f), hi(-1e30f);
+					for (int corner = 0; corner < 8; corner++) {
+						glm::vec3 p = rays[(y + (corner >> 1 & 1)) * (CLUSTER_X + 1) + x + (corner & 1)] * depths[corner >> 2];
+						lo = glm::min(lo, p);
+						hi = glm::max(hi, p);
+					}
+					int c = (z * CLUSTER_Y + y) * CLUSTER_X + x;
+					for (int k = 0; k < 3; k++) {
+						boxMin[k][c] = lo[k];
+						boxMax[k][c] = hi[k];
+					}
+				}
+			}
+		}
+	}
+
+	// conservative cluster block covered by a light's sphere; false if it is outside the frustum
+	bool clusterRange(const PointLight& light, const glm::mat4& view, const glm::mat4& projection, Candidate& c) const {
+		glm::vec3 centre = glm::vec3(view * glm::vec4(light.position, 1.0f));
+		float r = light.radius;
+		float depthMin = -centre.z - r, depthMax = -centre.z + r;
+		if (depthMax < nearPlane || depthMin > farPlane)
+			return false;
+		c.x = centre.x;
+		c.y = centre.y;
+		c.z = centre.z;
+		c.radius = r;
+		c.z0 = sliceOf(std::max(depthMin, nearPlane));
+		c.z1 = sliceOf(std::min(depthMax, farPlane));
+
+		float minX = 0.0f, minY = 0.0f, maxX = 1.0f, maxY = 1.0f;
+		// a sphere crossing the near plane can cover any part of the screen
+		if (depthMin > nearPlane) {
+			minX = minY = 1.0f;
+			maxX = maxY = 0.0f;
+			// project the corners of the sphere's view-space box; its hull contains the sphere's image
+			for (int corner = 0; corner < 8; corner++) {
+				glm::vec3 p = centre + glm::vec3(corner & 1 ? r : -r, corner & 2 ? r : -r, corner & 4 ? r : -r);
+				glm::vec4 clip = projection * glm::vec4(p, 1.0f);
+				float x = clip.x / clip.w * 0.5f + 0.5f;
+				float y = clip.y / clip.w * 0.5f + 0.5f;
+				minX = std::min(minX, x);
+				minY = std::min(minY, y);
+				maxX = std::max(maxX, x);
+				maxY = std::max(maxY, y);
+			}
+			if (maxX < 0.0f || maxY < 0.0f || minX > 1.0f || minY > 1.0f)
+				return false;
+		}
+		c.x0 = glm::clamp(static_cast<int>(minX * gridWidth / tileWidth), 0, CLUSTER_X - 1);
+		c.y0 = glm::clamp(static_cast<int>(minY * gridHeight / tileHeight), 0, CLUSTER_Y - 1);
+		c.x1 = glm::clamp(static_cast<int>(maxX * gridWidth / tileWidth), 0, CLUSTER_X - 1);
+		c.y1 = glm::clamp(static_cast<int>(maxY * gridHeight / tileHeight), 0, CLUSTER_Y - 1);
+		return true;
+	}
+
+	inline void append(int cluster, unsigned int light) {
+		unsigned int& count = clusterCounts[cluster];
+		if (count < static_cast<unsigned int>(MAX_LIGHTS_PER_CLUSTER))
+			clusterItems[cluster * MAX_LIGHTS_PER_CLUSTER + count++] = light;
+	}
+
+	// squared distance from a point to a cluster box, compared against the light's radius
+	inline bool touches(const Candidate& c, int cluster) const {
+		float dx = std::max(std::max(boxMin[0][cluster] - c.x, c.x - boxMax[0][cluster]), 0.0f);
+		float dy = std::max(std::max(boxMin[1][cluster] - c.y, c.y - boxMax[1][cluster]), 0.0f);
+		float dz = std::max(std::max(boxMin[2][cluster] - c.z, c.z - boxMax[2][cluster]), 0.0f);
+		return dx * dx + dy * dy + dz * dz <= c.radius * c.radius;
+	}
+
+	// bins every candidate light into the clusters of one depth slice
+	void binSlice(int z) {
+		int first = z * CLUSTER_Y * CLUSTER_X;
+		std::fill(&clusterCounts[first], &clusterCounts[first] + CLUSTER_Y * CLUSTER_X, 0u);
+		for (size_t i = 0; i < candidates.size(); i++) {
+			const Candidate& c = candidates[i];
+			if (z < c.z0 || z > c.z1)
+				continue;
+			unsigned int light = static_cast<unsigned int>(c.light);
+#ifdef LIGHTING_SSE
+			const __m128 cx = _mm_set1_ps(c.x), cy = _mm_set1_ps(c.y), cz = _mm_set1_ps(c.z);
+			const __m128 radius2 = _mm_set1_ps(c.radius * c.radius), zero = _mm_setzero_ps();
+#endif
+			for (int y = c.y0; y <= c.y1; y++) {
+				int row = first + y * CLUSTER_X;
+				int x = c.x0;
+#ifdef LIGHTING_SSE
+				// four clusters of the row per test
+				for (; x + 3 <= c.x1; x += 4) {
+					int cluster = row + x;
+					__m128 dx = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&boxMin[0][cluster]), cx), _mm_sub_ps(cx, _mm_loadu_ps(&boxMax[0][cluster]))), zero);
+					__m128 dy = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&boxMin[1][cluster]), cy), _mm_sub_ps(cy, _mm_loadu_ps(&boxMax[1][cluster]))), zero);
+					__m128 dz = _mm_max_ps(_mm_max_ps(_mm_sub_ps(_mm_loadu_ps(&boxMin[2][cluster]), cz), _mm_sub_ps(cz, _mm_loadu_ps(&boxMax[2][cluster]))), zero);
+					__m128 distance2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+					int mask = _mm_movemask_ps(_mm_cmple_ps(distance2, radius2));
+					for (int lane = 0; lane < 4; lane++)
+						if (mask & (1 << lane))
+							append(cluster + lane, light);
+				}
+#endif
+				for (; x <= c.x1; x++)
+					if (touches(c, row + x))
+						append(row + x, light);
+			}
+		}
+	}
+};
+
+#endif
@@ -13,6 +13,7 @@
 #include <glm/gtc/type_ptr.hpp>
 
 #include "shader.h"
+#include "shader_reload.h"
 #include "camera.h"
 #include "basic_camera.h"
 #include "table_sofa.h"
@@ -20,19 +21,66 @@
 #include "tool.h"
 #include "cylinders.h"
 #include "glass.h"
+#include "animation_clock.h"
+#include "input.h"
+#include "frame_pacer.h"
+#include "viewport.h"
+#include "mesh.h"
+#include "lighting.h"
+#include "benchmark.h"
+#include "render_queue.h"
+#include "mesh_optimize.h"
+#include "render_backend.h"
+#include "gl_backend.h"
+#include "software_raster.h"
+#include "regression.h"
+#include "capture.h"
+#include "camera_log.h"
+#include "camera_path.h"
+#include "trace.h"
+#include "hud.h"
+#include "stress_scene.h"
 #include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
+#include <algorithm>
 
 using namespace std;
 
 void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
 void processInput(GLFWwindow* window);
+int renderSoftware(RenderQueue& scene, RotatingPart& fanSpin, int frames);
 
 // settings
 const unsigned int SCR_WIDTH = 800;
 const unsigned int SCR_HEIGHT = 600;
 
+// real framebuffer size and the projection built from it
+Viewport viewport(SCR_WIDTH, SCR_HEIGHT);
+
+// point lights, binned into view-space clusters every frame
+Lighting lighting;
+LightBenchmark lightBenchmark;    // --bench-lights
+// golden-image checks of fixed camera poses
+RegressionSuite regression;    // --regress
+// video capture through asynchronous readback and a background encoder
+FrameRecorder recorder;    // --capture, --capture-raw
+// per-frame camera log for reproducible runs
+CameraLog cameraLog;
+const char* camera_record_path = NULL;    // --record
+const char* camera_replay_path = NULL;    // --replay
+// scripted camera flights
+PathPlayer flight;
+const char* flythrough_name = NULL;    // --flythrough
+// linked shader programs kept on disk between runs
+ShaderCache shaderCache;
+// generated halls of the restaurant's furniture instead of the restaurant
+StressScene stressScene;    // --stress
+
 // modelling transform
 float rotateAngle_X = 0;
 float rotateAngle_Y = 0;
@@ -48,12 +96,23 @@ float scale_Y = 1.0;
 float scale_Z = 1.0;
 bool fan_turn = false;
 bool rotate_around = false;
+bool depth_prepass = true;
+bool occlusion_culling = true;
+bool show_hud = false;    // performance overlay, toggled with H
+bool merge_static = true;    // --no-merge draws the static geometry item by item
+bool optimize_meshes = true;    // --no-mesh-opt keeps the vertex and index buffers as written
+int software_frames = 0;    // --software: frames to draw with the CPU rasteriser, 0 for the GL window
+int gpu_timer_frames = 0;    // --gpu-timers: frames per timing report, 0 for none
+std::string trace_path = "trace.json";    // --trace
 // camera
 Camera camera(glm::vec3(0.0f, 2.5f, 3.0f));
 float lastX = SCR_WIDTH / 2.0f;
 float lastY = SCR_HEIGHT / 2.0f;
 bool firstMouse = true;
 
+// keyboard: edge-triggered, rebindable actions fed by key_callback
+Input input;
+
 float eyeX = 0.0, eyeY = 0.0, eyeZ = 3.0;
 float lookAtX = 0.0, lookAtY = 0.0, lookAtZ = 0.0;
 glm::vec3 V = glm::vec3(0.0f, 1.0f, 0.0f);
@@ -63,6 +122,13 @@ BasicCamera basic_camera(eyeX, eyeY, eyeZ, lookAtX, lookAtY, lookAtZ, V);
 float deltaTime = 0.0f;    // time between current frame and last frame
 float lastFrame = 0.0f;
 
+// animation: fixed-step clock shared by every animated value
+AnimationClock animationClock;
+AnimationChannel cameraYaw(SPEED * 10.0f);    // rotate_around: orbit speed, degrees per second
+
+// frame pacing: vsync, optional FPS cap and on-demand (idle) rendering
+FramePacer framePacer;
+
 glm::mat4 transforamtion(float tx, float ty, float tz, float rx, float ry, float rz, float sx, float sy, float sz) {
 	glm::mat4 identityMatrix = glm::mat4(1.0f); // make sure to initialize matrix to identity matrix first
 	glm::mat4 translateMatrix, rotateXMatrix, rotateYMatrix, rotateZMatrix, scaleMatrix, model;
@@ -75,51 +141,104 @@ glm::mat4 transforamtion(float tx, float ty, float tz, float rx, float ry, float
 	return model;
 }
 
-int main()
+int main(int argc, char** argv)
 {
-	// glfw: initialize and configure
-	// ------------------------------
-	glfwInit();
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-
-#ifdef __APPLE__
-	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-#endif
-
-	// glfw window creation
-	// --------------------
-	GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "CSE 4208: Computer Graphics Laboratory", NULL, NULL);
-	if (window == NULL)
-	{
-		std::cout << "Failed to create GLFW window" << std::endl;
-		glfwTerminate();
-		return -1;
-	}
-	glfwMakeContextCurrent(window);
-	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
-	glfwSetCursorPosCallback(window, mouse_callback);
-	glfwSetScrollCallback(window, scroll_callback);
-
-	// tell GLFW to capture our mouse
-	//glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
-
-	// glad: load all OpenGL function pointers
-	// ---------------------------------------
-	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
-	{
-		std::cout << "Failed to initialize GLAD" << std::endl;
-		return -1;
+	Tracer::instance().nameThread("main");
+
+	// command line
+	// ------------
+	for (int a = 1; a < argc; a++) {
+		// --fixed-dt <seconds>: advance animation by a constant amount per frame (deterministic benchmarks)
+		if (strcmp(argv[a], "--fixed-dt") == 0 && a + 1 < argc)
+			animationClock.fixedFrameDelta = atof(argv[++a]);
+		// --swap-interval <n>: 0 renders uncapped, 1 is vsync
+		else if (strcmp(argv[a], "--swap-interval") == 0 && a + 1 < argc)
+			framePacer.swapInterval = atoi(argv[++a]);
+		// --fps <n>: cap the frame rate with high-resolution sleeps
+		else if (strcmp(argv[a], "--fps") == 0 && a + 1 < argc)
+			framePacer.targetFps = atof(argv[++a]);
+		// --on-demand: only redraw when input, animation or a resize needs a new frame
+		else if (strcmp(argv[a], "--on-demand") == 0)
+			framePacer.onDemand = true;
+		// --no-prepass: start with the depth pre-pass off (toggle with P)
+		else if (strcmp(argv[a], "--no-prepass") == 0)
+			depth_prepass = false;
+		// --no-occlusion: start with occlusion culling off (toggle with O)
+		else if (strcmp(argv[a], "--no-occlusion") == 0)
+			occlusion_culling = false;
+		// --no-merge: draw the static geometry item by item instead of as baked chunks
+		else if (strcmp(argv[a], "--no-merge") == 0)
+			merge_static = false;
+		// --no-mesh-opt: keep the meshes' vertices and triangles as written
+		else if (strcmp(argv[a], "--no-mesh-opt") == 0)
+			optimize_meshes = false;
+		// --hud: start with the performance overlay shown (toggle with H)
+		else if (strcmp(argv[a], "--hud") == 0)
+			show_hud = true;
+		// --no-shader-cache: compile every shader from source (cold start timing)
+		else if (strcmp(argv[a], "--no-shader-cache") == 0)
+			shaderCache.enabled = false;
+		// --bench-lights: time frames and light culling with 1 to MAX_LIGHTS lights, then exit
+		else if (strcmp(argv[a], "--bench-lights") == 0) {
+			lightBenchmark.active = true;
+			framePacer.swapInterval = 0;
+			framePacer.targetFps = 0.0;
+			framePacer.onDemand = false;
+		}
+		// --software <frames>: render headless with the CPU rasteriser, write the last frame and exit
+		else if (strcmp(argv[a], "--software") == 0 && a + 1 < argc)
+			software_frames = std::max(1, atoi(argv[++a]));
+		// --regress: render the regression poses, compare them with the golden images and exit
+		// (with --software, the software rasteriser's own goldens are checked)
+		else if (strcmp(argv[a], "--regress") == 0)
+			regression.active = true;
+		// --update-golden: like --regress, but store the frames as the new golden images
+		else if (strcmp(argv[a], "--update-golden") == 0)
+			regression.active = regression.update = true;
+		// --capture <prefix>: record every frame as <prefix>00000.ppm, <prefix>00001.ppm, ...
+		else if (strcmp(argv[a], "--capture") == 0 && a + 1 < argc) {
+			recorder.active = true;
+			recorder.format = CAPTURE_IMAGES;
+			recorder.path = argv[++a];
+		}
+		// --capture-raw <file>: record every frame into one raw RGBA stream (ffmpeg command printed at exit)
+		else if (strcmp(argv[a], "--capture-raw") == 0 && a + 1 < argc) {
+			recorder.active = true;
+			recorder.format = CAPTURE_RAW;
+			recorder.path = argv[++a];
+		}
+		// --record <file>: log the camera, animation clock and toggles of every frame
+		else if (strcmp(argv[a], "--record") == 0 && a + 1 < argc)
+			camera_record_path = argv[++a];
+		// --replay <file>: render exactly the frames of a --record log, then exit
+		else if (strcmp(argv[a], "--replay") == 0 && a + 1 < argc)
+			camera_replay_path = argv[++a];
+		// --flythrough <walkthrough|benchmark>: fly a scripted path (the benchmark flight exits and reports at its end)
+		else if (strcmp(argv[a], "--flythrough") == 0 && a + 1 < argc)
+			flythrough_name = argv[++a];
+		// --gpu-timers <frames>: time the passes and the parts of the restaurant on CPU and GPU, reported every <frames>
+		else if (strcmp(argv[a], "--gpu-timers") == 0 && a + 1 < argc)
+			gpu_timer_frames = std::max(1, atoi(argv[++a]));
+		// --stress <objects> | <N>x<M>[x<K>]: replace the restaurant with halls of its furniture, sized to about
+		// <objects> or with N x M tables on K floors (every benchmark mode then runs on them)
+		else if (strcmp(argv[a], "--stress") == 0 && a + 1 < argc) {
+			// a bad layout must not quietly benchmark the restaurant instead
+			if (!stressScene.parse(argv[++a]))
+				return 1;
+		}
+		// --stress-seed <n>: another random placement of the glasses
+		else if (strcmp(argv[a], "--stress-seed") == 0 && a + 1 < argc)
+			stressScene.layout.seed = static_cast<unsigned int>(strtoul(argv[++a], NULL, 10));
+		// --trace <file>: record a trace from the start (T writes it at any time, exit writes it again)
+		else if (strcmp(argv[a], "--trace") == 0 && a + 1 < argc) {
+			trace_path = argv[++a];
+			Tracer::instance().start();
+		}
 	}
+	// a recording plays back at a fixed rate, so animation advances by one video frame per frame
+	if (recorder.active && animationClock.fixedFrameDelta <= 0.0)
+		animationClock.fixedFrameDelta = 1.0 / recorder.frameRate;
 
-	// configure global opengl state
-	// -----------------------------
-	glEnable(GL_DEPTH_TEST);
-
-	// build and compile our shader zprogram
-	// ------------------------------------
-	Shader ourShader("vertexShader.vs", "fragmentShader.fs");
 	//0.5686f, 0.3529f, 0.2039f,
 	//VAO
 	// deep brown color 
@@ -757,294 +876,400 @@ int main()
 
 	};
 
-	unsigned int VBOL, VAOL, EBOL;
-	glGenVertexArrays(1, &VAOL);
-	glGenBuffers(1, &VBOL);
-	glGenBuffers(1, &EBOL);
-	glBindVertexArray(VAOL);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOL);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(black_color), black_color, GL_STATIC_DRAW);
-
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBOL);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cube_indices), cube_indices, GL_STATIC_DRAW);
-
-	// position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	//color attribute
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)12);
-	glEnableVertexAttribArray(1);
-
-	unsigned int VBO, VAO, EBO;
-	glGenVertexArrays(1, &VAO);
-	glGenBuffers(1, &VBO);
-	glGenBuffers(1, &EBO);
-	glBindVertexArray(VAO);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(table_top), table_top, GL_STATIC_DRAW);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cube_indices), cube_indices, GL_STATIC_DRAW);
-	// position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	//color attribute
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)12);
-	glEnableVertexAttribArray(1);
-
-	unsigned int VBOH, VAOH, EBOH;
-	glGenVertexArrays(1, &VAOH);
-	glGenBuffers(1, &VBOH);
-	glGenBuffers(1, &EBOH);
-	glBindVertexArray(VAOH);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOH);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(hangerwall), hangerwall, GL_STATIC_DRAW);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBOH);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cube_indices), cube_indices, GL_STATIC_DRAW);
-	// position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	//color attribute
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)12);
-	glEnableVertexAttribArray(1);
-
-
-	unsigned int VBO2, VAO2, EBO2;
-	glGenVertexArrays(1, &VAO2);
-	glGenBuffers(1, &VBO2);
-	glGenBuffers(1, &EBO2);
-	glBindVertexArray(VAO2);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO2);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(table_leg), table_leg, GL_STATIC_DRAW);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO2);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cube_indices), cube_indices, GL_STATIC_DRAW);
-	// position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	//color attribute
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)12);
-	glEnableVertexAttribArray(1);
-
-	unsigned int VBO3, VAO3, EBO3;
-	glGenVertexArrays(1, &VAO3);
-	glGenBuffers(1, &VBO3);
-	glGenBuffers(1, &EBO3);
-	glBindVertexArray(VAO3);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO3);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(chair_leg), chair_leg, GL_STATIC_DRAW);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO3);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cube_indices), cube_indices, GL_STATIC_DRAW);
-	// position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	//color attribute
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)12);
-	glEnableVertexAttribArray(1);
-
-	unsigned int VBO4, VAO4, EBO4;
-	glGenVertexArrays(1, &VAO4);
-	glGenBuffers(1, &VBO4);
-	glGenBuffers(1, &EBO4);
-	glBindVertexArray(VAO4);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO4);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(chair_sides), chair_sides, GL_STATIC_DRAW);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO4);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cube_indices), cube_indices, GL_STATIC_DRAW);
-	// position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	//color attribute
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)12);
-	glEnableVertexAttribArray(1);
-
-	unsigned int VBO5, VAO5, EBO5;
-	glGenVertexArrays(1, &VAO5);
-	glGenBuffers(1, &VBO5);
-	glGenBuffers(1, &EBO5);
-	glBindVertexArray(VAO5);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO5);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(chair_back), chair_back, GL_STATIC_DRAW);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO5);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cube_indices), cube_indices, GL_STATIC_DRAW);
-	// position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	//color attribute
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)12);
-	glEnableVertexAttribArray(1);
-
-	unsigned int VBOG, VAOG, EBOG;
-	glGenVertexArrays(1, &VAOG);
-	glGenBuffers(1, &VBOG);
-	glGenBuffers(1, &EBOG);
-	glBindVertexArray(VAOG);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOG);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(floor), floor, GL_STATIC_DRAW);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBOG);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cube_indices), cube_indices, GL_STATIC_DRAW);
-	// position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	//color attribute
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)12);
-	glEnableVertexAttribArray(1);
-
-	unsigned int VBOW1, VAOW1, EBOW1;
-	glGenVertexArrays(1, &VAOW1);
-	glGenBuffers(1, &VBOW1);
-	glGenBuffers(1, &EBOW1);
-	glBindVertexArray(VAOW1);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOW1);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(front_back_walls), front_back_walls, GL_STATIC_DRAW);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBOW1);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cube_indices), cube_indices, GL_STATIC_DRAW);
-	// position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	//color attribute
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)12);
-	glEnableVertexAttribArray(1);
-
-	unsigned int VBOW2, VAOW2, EBOW2;
-	glGenVertexArrays(1, &VAOW2);
-	glGenBuffers(1, &VBOW2);
-	glGenBuffers(1, &EBOW2);
-	glBindVertexArray(VAOW2);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOW2);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(side_walls), side_walls, GL_STATIC_DRAW);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBOW2);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cube_indices), cube_indices, GL_STATIC_DRAW);
-	// position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	//color attribute
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)12);
-	glEnableVertexAttribArray(1);
-
-	unsigned int VBOB, VAOB, EBOB;
-	glGenVertexArrays(1, &VAOB);
-	glGenBuffers(1, &VBOB);
-	glGenBuffers(1, &EBOB);
-	glBindVertexArray(VAOB);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOB);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(bar_table), bar_table, GL_STATIC_DRAW);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBOB);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cube_indices), cube_indices, GL_STATIC_DRAW);
-	// position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	//color attribute
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)12);
-	glEnableVertexAttribArray(1);
-
-	unsigned int VBOC, VAOC, EBOC;
-	glGenVertexArrays(1, &VAOC);
-	glGenBuffers(1, &VBOC);
-	glGenBuffers(1, &EBOC);
-	glBindVertexArray(VAOC);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOC);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(cabinate), cabinate, GL_STATIC_DRAW);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBOC);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cube_indices), cube_indices, GL_STATIC_DRAW);
-	// position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	//color attribute
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)12);
-	glEnableVertexAttribArray(1);
-
-	unsigned int VBOT, VAOT, EBOT;
-	glGenVertexArrays(1, &VAOT);
-	glGenBuffers(1, &VBOT);
-	glGenBuffers(1, &EBOT);
-	glBindVertexArray(VAOT);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOT);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(ceiling), ceiling, GL_STATIC_DRAW);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBOT);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cube_indices), cube_indices, GL_STATIC_DRAW);
-	// position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	//color attribute
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)12);
-	glEnableVertexAttribArray(1);
-
+	// materials: ambient, diffuse, specular, shininess (the colour comes from the vertices)
+	Material matte = { 0.45f, 0.9f, 0.05f, 8.0f };
+	Material wood = { 0.45f, 0.9f, 0.2f, 16.0f };
+	Material varnish = { 0.45f, 0.8f, 0.5f, 48.0f };
+	Material tiles = { 0.45f, 0.8f, 0.3f, 32.0f };
+	Material metal = { 0.4f, 0.7f, 0.6f, 64.0f };
+	Material glassy = { 0.4f, 0.6f, 0.9f, 128.0f };
+
+	// meshes: vertex arrays expanded with normals, uploaded once there is a context (mesh.h)
+	Mesh meshL = buildMesh(black_color, sizeof(black_color), cube_indices, sizeof(cube_indices), matte);
+	Mesh mesh = buildMesh(table_top, sizeof(table_top), cube_indices, sizeof(cube_indices), wood);
+	Mesh meshH = buildMesh(hangerwall, sizeof(hangerwall), cube_indices, sizeof(cube_indices), matte);
+	Mesh mesh2 = buildMesh(table_leg, sizeof(table_leg), cube_indices, sizeof(cube_indices), metal);
+	Mesh mesh3 = buildMesh(chair_leg, sizeof(chair_leg), cube_indices, sizeof(cube_indices), metal);
+	Mesh mesh4 = buildMesh(chair_sides, sizeof(chair_sides), cube_indices, sizeof(cube_indices), wood);
+	Mesh mesh5 = buildMesh(chair_back, sizeof(chair_back), cube_indices, sizeof(cube_indices), matte);
+	Mesh meshG = buildMesh(floor, sizeof(floor), cube_indices, sizeof(cube_indices), tiles);
+	Mesh meshW1 = buildMesh(front_back_walls, sizeof(front_back_walls), cube_indices, sizeof(cube_indices), matte);
+	Mesh meshW2 = buildMesh(side_walls, sizeof(side_walls), cube_indices, sizeof(cube_indices), matte);
+	Mesh meshB = buildMesh(bar_table, sizeof(bar_table), cube_indices, sizeof(cube_indices), varnish);
+	Mesh meshC = buildMesh(cabinate, sizeof(cabinate), cube_indices, sizeof(cube_indices), wood);
+	Mesh meshT = buildMesh(ceiling, sizeof(ceiling), cube_indices, sizeof(cube_indices), matte);
 	//Fan
-	unsigned int VBOF1, VAOF1, EBOF1;
-	glGenVertexArrays(1, &VAOF1);
-	glGenBuffers(1, &VBOF1);
-	glGenBuffers(1, &EBOF1);
-	glBindVertexArray(VAOF1);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOF1);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(fan_cup), fan_cup, GL_STATIC_DRAW);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBOF1);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cube_indices), cube_indices, GL_STATIC_DRAW);
-	// position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	//color attribute
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)12);
-	glEnableVertexAttribArray(1);
-
-	unsigned int VBOF2, VAOF2, EBOF2;
-	glGenVertexArrays(1, &VAOF2);
-	glGenBuffers(1, &VBOF2);
-	glGenBuffers(1, &EBOF2);
-	glBindVertexArray(VAOF2);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOF2);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(fan_hanging_rod), fan_hanging_rod, GL_STATIC_DRAW);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBOF2);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cube_indices), cube_indices, GL_STATIC_DRAW);
-	// position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	//color attribute
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)12);
-	glEnableVertexAttribArray(1);
-
-	unsigned int VBOF3, VAOF3, EBOF3;
-	glGenVertexArrays(1, &VAOF3);
-	glGenBuffers(1, &VBOF3);
-	glGenBuffers(1, &EBOF3);
-	glBindVertexArray(VAOF3);
-	glBindBuffer(GL_ARRAY_BUFFER, VBOF3);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(fan_blade), fan_blade, GL_STATIC_DRAW);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBOF3);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(cube_indices), cube_indices, GL_STATIC_DRAW);
-	// position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	//color attribute
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)12);
-	glEnableVertexAttribArray(1);
-
-	int i = 0;
+	Mesh meshF1 = buildMesh(fan_cup, sizeof(fan_cup), cube_indices, sizeof(cube_indices), metal);
+	Mesh meshF2 = buildMesh(fan_hanging_rod, sizeof(fan_hanging_rod), cube_indices, sizeof(cube_indices), metal);
+	Mesh meshF3 = buildMesh(fan_blade, sizeof(fan_blade), cube_indices, sizeof(cube_indices), wood);
+
 	Table_Sofa table_chair[4];
 	Tool tools[5];
 	Glass glass[5];
 	Cylinders cylinder[5];
+	Fan fan;
 	//cylinder.generateVertices();
 	//float* ver_arr = cylinder.arr;
 	//int* ind_arr = cylinder.indices;
 
-	unsigned int VBO_CIRC, VAO_CIRC, EBO_CIRC;
-	glGenVertexArrays(1, &VAO_CIRC);
-	glGenBuffers(1, &VBO_CIRC);
-	glGenBuffers(1, &EBO_CIRC);
-	glBindVertexArray(VAO_CIRC);
-	glBindBuffer(GL_ARRAY_BUFFER, VBO_CIRC);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(ver_arr), ver_arr, GL_STATIC_DRAW);
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO_CIRC);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(ind_arr), ind_arr, GL_STATIC_DRAW);
-	// position attribute
-	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)0);
-	glEnableVertexAttribArray(0);
-	//color attribute
-	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 6 * sizeof(float), (void*)12);
-	glEnableVertexAttribArray(1);
+	Mesh meshCirc = buildMesh(ver_arr, sizeof(ver_arr), ind_arr, sizeof(ind_arr), glassy);
+	Mesh* meshes[] = { &meshL, &mesh, &meshH, &mesh2, &mesh3, &mesh4, &mesh5, &meshG, &meshW1, &meshW2,
+		&meshB, &meshC, &meshT, &meshF1, &meshF2, &meshF3, &meshCirc };
+	const char* meshNames[] = { "lines", "table top", "hanger wall", "table leg", "chair leg", "chair sides", "chair back", "floor",
+		"front/back walls", "side walls", "bar table", "cabinet", "ceiling", "fan cup", "fan rod", "fan blade", "cylinder" };
+	// duplicate and unused vertices removed, triangles in vertex cache order, vertices in
+	// fetch order (mesh_optimize.h)
+	if (optimize_meshes) {
+		int weldedBytes = 0;
+		for (size_t m = 0; m < sizeof(meshes) / sizeof(meshes[0]); m++) {
+			weldedBytes += weldMesh(*meshes[m], meshNames[m]).bytesSaved;
+			optimizeMesh(*meshes[m], meshNames[m]);
+		}
+		printf("mesh weld: %d bytes of vertices saved in total\n", weldedBytes);
+	}
+
+	// lights: a lamp over every table, three along the bar and daylight from the window;
+	// the table and bar lamps cast shadows (the window light is left soft)
+	std::vector<int> shadowedLights;
+	lighting.ambientColor = glm::vec3(1.0f, 0.97f, 0.92f);
+	for (int i = 0; i < 4; i++)
+		shadowedLights.push_back(lighting.add({ glm::vec3(5.375f, 2.5f, 0.64f - 2 * i), 4.0f, glm::vec3(1.0f, 0.85f, 0.6f), 2.0f }));
+	for (int i = 0; i < 3; i++)
+		shadowedLights.push_back(lighting.add({ glm::vec3(-0.4f, 2.5f, -5.5f + 2.75f * i), 3.5f, glm::vec3(1.0f, 0.75f, 0.45f), 1.5f }));
+	lighting.add({ glm::vec3(2.75f, 1.2f, -8.3f), 6.0f, glm::vec3(0.75f, 0.85f, 1.0f), 2.5f });
+
+	// scene: recorded once, replayed by the shadow and main passes; the transforms
+	// never change and the fan blades spin in the vertex shader
+	// -----------------------------------------------------------------------------
+	RenderQueue scene;
+	glm::mat4 model;
+	//Table chair
+	scene.category = CATEGORY_TABLES;
+	float shiftx = 4, shiftz = 0;
+	for (int i = 0; i < 4; i++) {
+		table_chair[i].tox = shiftx;
+		table_chair[i].toz = shiftz;
+		scene.beginGroup();
+		table_chair[i].submit(scene, mesh, mesh2, meshC, mesh4, mesh5);
+		scene.endGroup();
+		shiftz -= 2;
+	}
+	
+	//Tools
+	scene.category = CATEGORY_TOOLS;
+	float shiftx_tool = -0.1, shiftz_tool = 0;
+	for (int i = 0; i < 5; i++) {
+		tools[i].tox = shiftx_tool;
+		tools[i].toz = shiftz_tool;
+		scene.beginGroup();
+		tools[i].submit(scene, meshCirc, mesh2);
+		scene.endGroup();
+		shiftz_tool -= 2;
+	}
+	
+
+
+	//Floor
+	scene.category = CATEGORY_ROOM;
+	model = transforamtion(-2.5, -.8, -9, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 20, 0.1, 24);
+	scene.add(meshG, model);
+
+	//front_back_walls
+	model = transforamtion(-2.5, -.75, -9, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 20, 7, 0.2);
+	scene.add(meshW1, model);
+	
+	model = transforamtion(-2.5, -.75, 3, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 20, 7, 0.2);
+	scene.add(meshW1, model);
+
+	
+	
+	//side_walls
+	model = transforamtion(-2.5, -.75, -9, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, .2, 7, 24);
+	scene.add(meshW2, model);
+
+	model = transforamtion(7.5, -.75, -9, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, .2, 7, 24);
+	scene.add(meshW2, model);
+
+	
+	//Rack
+	//backside of rack
+	model = transforamtion(-2.35, -0.75, -7, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, .2, 5, 17);
+	scene.add(meshC, model);
+	//both side of rack
+	//inner side
+	model = transforamtion(-2.35, -0.75, -7, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 2, 5, 0.2);
+	scene.add(meshC, model);
+	//outer side
+	model = transforamtion(-2.35, -0.75, 1.4, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 2, 5, 0.2);
+	scene.add(meshC, model);
+	//3 racks holding utensils
+	//first rack
+	model = transforamtion(-2.35, -.625, -7, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 2, .2, 17);
+	scene.add(meshC, model);
+	//second rack
+	model = transforamtion(-2.35, 0.375, -7, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 2, .2, 17);
+	scene.add(meshC, model);
+	//third rack
+	model = transforamtion(-2.35, 1.375, -7, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 2, .2, 17);
+	scene.add(meshC, model);
+
+	//placing glasses on rack
+	scene.category = CATEGORY_GLASSES;
+	float shiftx_glass = -2, shiftz_glass = 0.0;
+	for (int i = 0; i < 5; i++) {
+		glass[i].tox = shiftx_glass;
+		glass[i].toz = shiftz_glass;
+		scene.beginGroup();
+		glass[i].submit(scene, meshCirc);
+		scene.endGroup();
+		shiftz_glass -= 1.5;
+	}
+
+
+
+	//Big Bar table
+	scene.category = CATEGORY_ROOM;
+	model = transforamtion(-0.75, -0.75, -7, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 1.5, 2, 17);
+	scene.add(meshB, model);
+
+	//window
+	//pordar hanger
+	model = transforamtion(.65, 1.4, -9, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 8.4, 1, .75);
+	scene.add(meshH, model);
+
+	//black portion
+	model = transforamtion(1, -.6, -9, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 7, 4, .5);
+	scene.add(meshB, model);
+	//middle portion
+	model = transforamtion(1.15, -.35, -9, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 3.05, 3.5, .51);
+	scene.add(meshG, model);
+	//middle portion
+	model = transforamtion(2.825, -.35, -9, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 3.05, 3.5, .51);
+	scene.add(meshG, model);
+
+
+	//Ceiling
+	model = transforamtion(-2.5, 2.75, -9, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 20, 0.1, 24);
+	scene.add(meshT, model);
+
+
+	//Fan
+	scene.category = CATEGORY_FAN;
+	model = transforamtion(2, 2.75, -6, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 1, -.25, 1);
+	scene.add(meshF1, model);
+
+	model = transforamtion(2.125, 2.35, -5.875, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, .5, .5, .5);
+	scene.add(meshF2, model);
+
+	scene.category = CATEGORY_GRID;
+	for (int i = 0; i < 4; i++) {
+		model = transforamtion(-.4 + 2 * i, -.75, -9, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, .01, .01, 24);
+		scene.add(meshL, model);
+	}
+
+	for (int i = 0; i < 5; i++) {
+		model = transforamtion(-2.4, -.75, -7 + 2 * i, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 24, .01, .01);
+		scene.add(meshL, model);
+	}
+
+
+	//Fan circle
+	scene.category = CATEGORY_FAN;
+	//lower portion
+	model = transforamtion(2.25, 2.35, -5.75, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, .35, 0.1, .35);
+	scene.add(meshCirc, model);
+	//upper portion
+	model = transforamtion(2.25, 2.45, -5.75, rotateAngle_X, rotateAngle_Y, 180.0f, .35, 0.01, .35);
+	scene.add(meshCirc, model);
+
+
+	fan.submit(scene, meshF3);
+
+	// --stress: the recorded restaurant and its lights make way for the generated halls
+	if (stressScene.active) {
+		scene = RenderQueue();
+		lighting.lights.clear();
+		HallMeshes hallMeshes = { &meshG, &meshT, &meshW1, &meshW2, &meshC, &mesh, &mesh2, &mesh4, &mesh5, &meshCirc, &meshF1, &meshF2, &meshF3 };
+		stressScene.generate(scene, lighting, hallMeshes);
+		shadowedLights = stressScene.shadowedLamps;
+	}
+	// the static shell, grid and fan housing as a handful of world-space meshes
+	if (merge_static)
+		scene.mergeStatic();
+	if (optimize_meshes && !scene.merged.empty()) {
+		double before = 0.0, after = 0.0;
+		int triangles = 0, verticesBefore = 0, verticesAfter = 0, weldedBytes = 0;
+		for (size_t m = 0; m < scene.merged.size(); m++) {
+			MeshWeldResult weld = weldMesh(scene.merged[m], NULL);
+			verticesBefore += weld.verticesBefore;
+			verticesAfter += weld.verticesAfter;
+			weldedBytes += weld.bytesSaved;
+			MeshOptimizeResult result = optimizeMesh(scene.merged[m], NULL);
+			before += result.acmrBefore * result.triangles;
+			after += result.acmrAfter * result.triangles;
+			triangles += result.triangles;
+		}
+		printf("mesh optimise: %d merged chunks, %d triangles, ACMR %.3f -> %.3f\n", static_cast<int>(scene.merged.size()),
+			triangles, before / std::max(1, triangles), after / std::max(1, triangles));
+		printf("mesh weld: %d merged chunks, %d -> %d vertices, %d bytes saved\n", static_cast<int>(scene.merged.size()),
+			verticesBefore, verticesAfter, weldedBytes);
+	}
+
+	// regression poses: the start view, the tables, the bar, the window wall and the fan mid-turn
+	regression.add("entrance", glm::vec3(0.0f, 2.5f, 3.0f), -90.0f, 0.0f);
+	regression.add("tables", glm::vec3(2.0f, 1.6f, 1.5f), -60.0f, -15.0f);
+	regression.add("bar", glm::vec3(3.5f, 1.8f, -0.5f), -150.0f, -15.0f);
+	regression.add("window", glm::vec3(2.5f, 1.5f, -3.0f), -90.0f, 0.0f);
+	regression.add("fan", glm::vec3(2.25f, 1.2f, -3.5f), -90.0f, 35.0f, 0.37f);
+
+	// scripted flights: a looping walkthrough for clients, and the benchmark flight through the
+	// most expensive views (the whole room and all its lights from each corner, then the fan)
+	CameraPath walkthrough("walkthrough", PATH_CATMULL_ROM, true);
+	walkthrough.add(0.0f, glm::vec3(0.0f, 2.2f, 2.5f), glm::vec3(1.5f, 1.2f, -3.0f));
+	walkthrough.add(4.0f, glm::vec3(2.5f, 1.7f, 1.0f), glm::vec3(4.5f, 0.8f, -1.0f));
+	walkthrough.add(8.0f, glm::vec3(3.0f, 1.6f, -3.0f), glm::vec3(-1.0f, 1.0f, -4.0f));
+	walkthrough.add(12.0f, glm::vec3(2.5f, 1.5f, -5.0f), glm::vec3(2.75f, 1.2f, -8.3f));
+	walkthrough.add(16.0f, glm::vec3(1.0f, 1.8f, -6.0f), glm::vec3(2.25f, 2.4f, -5.75f));
+	walkthrough.add(20.0f, glm::vec3(0.0f, 2.2f, 2.5f), glm::vec3(1.5f, 1.2f, -3.0f));
+	CameraPath benchmarkFlight("benchmark", PATH_BEZIER, false);
+	benchmarkFlight.add(0.0f, glm::vec3(-1.0f, 2.4f, -8.0f), glm::vec3(4.0f, 0.5f, 1.0f));
+	benchmarkFlight.add(0.0f, glm::vec3(1.5f, 2.5f, -8.5f), glm::vec3(3.0f, 0.5f, 1.0f));
+	benchmarkFlight.add(0.0f, glm::vec3(4.5f, 2.5f, -8.5f), glm::vec3(1.0f, 0.5f, 1.0f));
+	benchmarkFlight.add(6.0f, glm::vec3(7.0f, 2.4f, -8.0f), glm::vec3(0.0f, 0.5f, 1.0f));
+	benchmarkFlight.add(0.0f, glm::vec3(7.0f, 2.4f, -3.0f), glm::vec3(0.0f, 0.5f, -2.0f));
+	benchmarkFlight.add(0.0f, glm::vec3(7.0f, 2.4f, 2.5f), glm::vec3(0.0f, 0.5f, -6.0f));
+	benchmarkFlight.add(12.0f, glm::vec3(-1.0f, 2.4f, 2.5f), glm::vec3(5.0f, 0.5f, -7.0f));
+	benchmarkFlight.add(0.0f, glm::vec3(1.0f, 1.8f, -1.0f), glm::vec3(2.25f, 2.4f, -5.75f));
+	benchmarkFlight.add(0.0f, glm::vec3(2.0f, 1.4f, -3.5f), glm::vec3(2.25f, 2.4f, -5.75f));
+	benchmarkFlight.add(18.0f, glm::vec3(2.25f, 1.3f, -4.8f), glm::vec3(2.25f, 2.4f, -5.75f));
+
+	// without a GPU: the same scene through the software rasteriser, no window at all
+	if (software_frames > 0) {
+		int result = renderSoftware(scene, fan.spin, software_frames);
+		if (Tracer::instance().enabled())
+			Tracer::instance().dump(trace_path);
+		return result;
+	}
+
+	// glfw: initialize and configure
+	// ------------------------------
+	glfwInit();
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+	glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+	glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+	// the regression suite renders offscreen, no window has to show up
+	if (regression.active)
+		glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
+#ifdef __APPLE__
+	glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+#endif
+
+	// glfw window creation
+	// --------------------
+	GLFWwindow* window = glfwCreateWindow(SCR_WIDTH, SCR_HEIGHT, "CSE 4208: Computer Graphics Laboratory", NULL, NULL);
+	if (window == NULL)
+	{
+		std::cout << "Failed to create GLFW window" << std::endl;
+		glfwTerminate();
+		return -1;
+	}
+	glfwMakeContextCurrent(window);
+	framePacer.apply();
+	// the framebuffer can be larger than the requested window size on high-DPI screens
+	int framebufferWidth, framebufferHeight;
+	glfwGetFramebufferSize(window, &framebufferWidth, &framebufferHeight);
+	viewport.resize(framebufferWidth, framebufferHeight);
+	glfwSetFramebufferSizeCallback(window, framebuffer_size_callback);
+	glfwSetCursorPosCallback(window, mouse_callback);
+	glfwSetScrollCallback(window, scroll_callback);
+	glfwSetKeyCallback(window, key_callback);
+	input.loadBindings("keybindings.cfg");
 
+	// tell GLFW to capture our mouse
+	//glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+	// glad: load all OpenGL function pointers
+	// ---------------------------------------
+	if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+	{
+		std::cout << "Failed to initialize GLAD" << std::endl;
+		return -1;
+	}
+
+	// configure global opengl state
+	// -----------------------------
+	glEnable(GL_DEPTH_TEST);
+
+	// build and compile our shader zprogram
+	// ------------------------------------
+	for (Mesh* m : meshes)
+		uploadMesh(*m);
+	for (size_t m = 0; m < scene.merged.size(); m++)
+		uploadMesh(scene.merged[m]);
+	lighting.init();
+
+	// the OpenGL renderer
+	shaderCache.init((GLADloadproc)glfwGetProcAddress);
+	GLBackend renderer("vertexShader.vs", "fragmentShader.fs", &shaderCache);
+	// frame times, draw counts, culling and memory over the frame
+	PerformanceHud hud("hud.vs", "hud.fs", &shaderCache);
+	for (Mesh* m : meshes)
+		hud.geometryBytes += m->vertices.size() * sizeof(float) + m->indices.size() * sizeof(unsigned int);
+	for (size_t m = 0; m < scene.merged.size(); m++)
+		hud.geometryBytes += scene.merged[m].vertices.size() * sizeof(float) + scene.merged[m].indices.size() * sizeof(unsigned int);
+	shaderCache.report();
+	// edited shaders are rebuilt and swapped in while the program runs
+	ShaderReloader shaderReloader;
+	shaderReloader.watch(renderer.shaders);
+	shaderReloader.watch(hud.shader, hud.vertexPath, hud.fragmentPath);
+	shaderReloader.start((GLADloadproc)glfwGetProcAddress);
+	renderer.timers.enabled = gpu_timer_frames > 0;
+	renderer.timers.interval = gpu_timer_frames;
+	renderer.init(scene, lighting, shadowedLights);
+	hud.init();
+	if (recorder.active)
+		recorder.start();
+	if (camera_record_path)
+		cameraLog.startRecording(camera_record_path, viewport.width, viewport.height);
+	if (camera_replay_path && cameraLog.startReplay(camera_replay_path))
+		cameraLog.checkViewport(viewport.width, viewport.height);
+	if (flythrough_name) {
+		const CameraPath* flights[] = { &walkthrough, &benchmarkFlight };
+		for (const CameraPath* path : flights)
+			if (path->name == flythrough_name)
+				flight.start(*path, animationClock.seconds());
+		if (!flight.active())
+			std::cout << "ERROR::FLYTHROUGH::UNKNOWN_PATH: " << flythrough_name << " (walkthrough or benchmark)" << std::endl;
+	}
+	double titleTime = 0.0;
+
+	int exitCode = 0;
+	if (regression.active) {
+		// offscreen at the suite's size, with the fan turning so the blade angle is checked too;
+		// no occlusion culling, whose queries would come from the previous pose's camera
+		renderer.offscreen = true;
+		renderer.occlusion.enabled = false;
+		fan.spin.start(0.0f);
+		exitCode = regression.run(renderer, scene, lighting) > 0 ? 1 : 0;
+		glfwSetWindowShouldClose(window, true);
+	}
+
+	if (lightBenchmark.active)
+		lightBenchmark.begin(lighting);
 
 	while (!glfwWindowShouldClose(window))
 	{
+		// frame pacing: when idle in on-demand mode (or minimised), sleep until an event arrives
+		// -------------------------------------------------------------------------
+		if (viewport.minimized() || !framePacer.frameNeeded(fan_turn || rotate_around || input.active() || cameraLog.replayActive() || flight.active())) {
+			framePacer.waitForEvents();
+			// don't let the idle period show up as one huge frame delta
+			lastFrame = static_cast<float>(glfwGetTime());
+			continue;
+		}
+		TRACE_SCOPE("frame");
+
 		// per-frame time logic
 		// --------------------
 		float currentFrame = static_cast<float>(glfwGetTime());
@@ -1055,240 +1280,127 @@ int main()
 		// -----
 		processInput(window);
 
-		// render
-		// ------
-		glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-
-		// activate shader
-		ourShader.use();
-		glm::mat4 model;
-		// pass projection matrix to shader (note that in this case it could change every frame)
-		glm::mat4 projection = glm::perspective(glm::radians(camera.Zoom), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-		//glm::mat4 projection = glm::ortho(-2.0f, +2.0f, -1.5f, +1.5f, 0.1f, 100.0f);
-		ourShader.setMat4("projection", projection);
-
-		// camera/view transformation
-		float degree = 0;
-		glm::mat4 view = camera.GetViewMatrix();
-		float r = glm::length(camera.Position - glm::vec3(view[3]));
-		ourShader.setMat4("view", view);
-
-		//Table chair
-		float shiftx = 4, shiftz = 0;
-		for (int i = 0; i < 4; i++) {
-			table_chair[i].tox = shiftx;
-			table_chair[i].toz = shiftz;
-			ourShader = table_chair[i].ret_shader(ourShader, VAO, VAO2, VAOC, VAO4, VAO5);
-			shiftz -= 2;
-		}
-		
-		//Tools
-		float shiftx_tool = -0.1, shiftz_tool = 0;
-		for (int i = 0; i < 5; i++) {
-			tools[i].tox = shiftx_tool;
-			tools[i].toz = shiftz_tool;
-			ourShader = tools[i].ret_shader(ourShader, VAO_CIRC, VAO2, VAO3);
-			shiftz_tool -= 2;
-		}
-		
-
-
-		//Floor
-		model = transforamtion(-2.5, -.8, -9, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 20, 0.1, 24);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAOG);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-		//front_back_walls
-		model = transforamtion(-2.5, -.75, -9, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 20, 7, 0.2);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAOW1);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-		
-		model = transforamtion(-2.5, -.75, 3, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 20, 7, 0.2);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAOW1);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-		
-		
-		//side_walls
-		model = transforamtion(-2.5, -.75, -9, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, .2, 7, 24);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAOW2);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-		model = transforamtion(7.5, -.75, -9, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, .2, 7, 24);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAOW2);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-		
-		//Rack
-		//backside of rack
-		model = transforamtion(-2.35, -0.75, -7, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, .2, 5, 17);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAOC);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-		//both side of rack
-		//inner side
-		model = transforamtion(-2.35, -0.75, -7, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 2, 5, 0.2);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAOC);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-		//outer side
-		model = transforamtion(-2.35, -0.75, 1.4, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 2, 5, 0.2);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAOC);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-		//3 racks holding utensils
-		//first rack
-		model = transforamtion(-2.35, -.625, -7, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 2, .2, 17);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAOC);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-		//second rack
-		model = transforamtion(-2.35, 0.375, -7, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 2, .2, 17);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAOC);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-		//third rack
-		model = transforamtion(-2.35, 1.375, -7, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 2, .2, 17);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAOC);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-		//placing glasses on rack
-		float shiftx_glass = -2, shiftz_glass = 0.0;
-		for (int i = 0; i < 5; i++) {
-			glass[i].tox = shiftx_glass;
-			glass[i].toz = shiftz_glass;
-			ourShader = glass[i].ret_shader(ourShader, VAO_CIRC, VAO2, VAO3);
-			shiftz_glass -= 1.5;
+		// animation
+		// ---------
+		int animationSteps = animationClock.advance(deltaTime);
+		cameraYaw.running = rotate_around;
+		if (rotate_around)
+			camera.Orbit(glm::radians(cameraYaw.advance(animationSteps, animationClock.step)), 0.0f);
+		if (flight.active() && !flight.update(camera, animationClock.seconds(), deltaTime))
+			glfwSetWindowShouldClose(window, true);
+		// a replay overrides live input and the clock with the recorded frame
+		if (cameraLog.replayActive()) {
+			CameraSample sample;
+			if (!cameraLog.next(sample)) {
+				glfwSetWindowShouldClose(window, true);
+				continue;
+			}
+			CameraLog::apply(sample, camera);
+			animationClock.ticks = sample.ticks;
+			fan_turn = (sample.flags & CAMERA_LOG_FAN) != 0;
+			depth_prepass = (sample.flags & CAMERA_LOG_PREPASS) != 0;
+			occlusion_culling = (sample.flags & CAMERA_LOG_OCCLUSION) != 0;
 		}
+		if (fan_turn)
+			fan.spin.start(animationClock.time());
+		else
+			fan.spin.stop(animationClock.time());
+		stressScene.spinFans(fan_turn, animationClock.time());
+		if (cameraLog.recording())
+			cameraLog.record(camera, animationClock.ticks,
+				(fan_turn ? CAMERA_LOG_FAN : 0) | (depth_prepass ? CAMERA_LOG_PREPASS : 0) | (occlusion_culling ? CAMERA_LOG_OCCLUSION : 0));
 
-
-
-		//Big Bar table
-		model = transforamtion(-0.75, -0.75, -7, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 1.5, 2, 17);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAOB);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-		//window
-		//pordar hanger
-		model = transforamtion(.65, 1.4, -9, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 8.4, 1, .75);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAOH);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-		//black portion
-		model = transforamtion(1, -.6, -9, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 7, 4, .5);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAOB);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-		//middle portion
-		model = transforamtion(1.15, -.35, -9, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 3.05, 3.5, .51);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAOG);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-		//middle portion
-		model = transforamtion(2.825, -.35, -9, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 3.05, 3.5, .51);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAOG);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-
-		//Ceiling
-		model = transforamtion(-2.5, 2.75, -9, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 20, 0.1, 24);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAOT);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-
-		//Fan
-		model = transforamtion(2, 2.75, -6, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 1, -.25, 1);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAOF1);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-		model = transforamtion(2.125, 2.35, -5.875, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, .5, .5, .5);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAOF2);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-
-		for (int i = 0; i < 4; i++) {
-			model = transforamtion(-.4 + 2 * i, -.75, -9, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, .01, .01, 24);
-			ourShader.setMat4("model", model);
-			glBindVertexArray(VAOL);
-			glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+		// render
+		// ------
+		shaderReloader.update();
+		// projection is rebuilt by the viewport only when zoom or framebuffer size change
+		FrameParams frame(viewport);
+		frame.view = camera.GetViewMatrix();
+		frame.projection = viewport.projection(camera.Zoom);
+		frame.eye = camera.Position;
+		frame.time = animationClock.seconds();
+		renderer.depthPrepass = depth_prepass;
+		renderer.occlusion.enabled = occlusion_culling;
+		renderer.render(scene, lighting, frame);
+		if (recorder.active)
+			recorder.capture(renderer);
+		hud.frame();
+		// drawn after the capture's readback, so recordings don't show it
+		if (show_hud)
+			hud.draw(viewport, scene, renderer.occlusion);
+
+		// overdraw in the title, twice a second
+		if (glfwGetTime() - titleTime > 0.5) {
+			titleTime = glfwGetTime();
+			char title[160];
+			snprintf(title, sizeof(title), "CSE 4208: Computer Graphics Laboratory | pre-pass %s | overdraw %.2fx | occlusion %s, %d/%d hidden",
+				depth_prepass ? "on" : "off", renderer.overdraw.ratio, occlusion_culling ? "on" : "off", renderer.occlusion.hiddenGroups, static_cast<int>(scene.groups.size()));
+			glfwSetWindowTitle(window, title);
 		}
 
-		for (int i = 0; i < 5; i++) {
-			model = transforamtion(-2.4, -.75, -7 + 2 * i, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 24, .01, .01);
-			ourShader.setMat4("model", model);
-			glBindVertexArray(VAOL);
-			glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+		{
+			TRACE_SCOPE("swap buffers");
+			glfwSwapBuffers(window);
 		}
-
-
-		//Fan circle
-		//lower portion
-		model = transforamtion(2.25, 2.35, -5.75, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, .35, 0.1, .35);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAO_CIRC);
-		glDrawElements(GL_TRIANGLES, 90, GL_UNSIGNED_INT, 0);
-		//upper portion
-		model = transforamtion(2.25, 2.45, -5.75, rotateAngle_X, rotateAngle_Y, 180.0f, .35, 0.01, .35);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAO_CIRC);
-		glDrawElements(GL_TRIANGLES, 90, GL_UNSIGNED_INT, 0);
-
-
-		Fan fan;
-		ourShader = fan.local_rotation(ourShader, VAOF3, i);
-
-		if (fan_turn)
-			i += 5;
-		if (rotate_around)
-			camera.ProcessKeyboard(Y_LEFT, deltaTime);
-		
-		glfwSwapBuffers(window);
+		framePacer.limit();
+		if (lightBenchmark.active && !lightBenchmark.endFrame(lighting))
+			glfwSetWindowShouldClose(window, true);
 		glfwPollEvents();
 	}
 
 	// optional: de-allocate all resources once they've outlived their purpose:
 	// ------------------------------------------------------------------------
-	glDeleteVertexArrays(1, &VAO);
-	glDeleteBuffers(1, &VBO);
-	glDeleteBuffers(1, &EBO);
-	glDeleteVertexArrays(1, &VAO2);
-	glDeleteBuffers(1, &VBO2);
-	glDeleteBuffers(1, &EBO2);
-	glDeleteVertexArrays(1, &VAO3);
-	glDeleteBuffers(1, &VBO3);
-	glDeleteBuffers(1, &EBO3);
-	glDeleteVertexArrays(1, &VAO4);
-	glDeleteBuffers(1, &VBO4);
-	glDeleteBuffers(1, &EBO4);
-	glDeleteVertexArrays(1, &VAO5);
-	glDeleteBuffers(1, &VBO5);
-	glDeleteBuffers(1, &EBO5);
-	glDeleteVertexArrays(1, &VAOG);
-	glDeleteBuffers(1, &VBOG);
-	glDeleteBuffers(1, &EBOG);
-	glDeleteVertexArrays(1, &VAOW1);
-	glDeleteBuffers(1, &VBOW1);
-	glDeleteBuffers(1, &EBOW1);
-	glDeleteVertexArrays(1, &VAOW2);
-	glDeleteBuffers(1, &VBOW2);
-	glDeleteBuffers(1, &EBOW2);
+	for (Mesh* m : meshes)
+		deleteMesh(*m);
+	for (size_t m = 0; m < scene.merged.size(); m++)
+		deleteMesh(scene.merged[m]);
+	lighting.release();
+	recorder.stop(&renderer);
+	cameraLog.finish();
+	flight.report();
+	shaderReloader.stop();
+	hud.release();
+	renderer.release(scene);
+	if (Tracer::instance().enabled())
+		Tracer::instance().dump(trace_path);
 
 	// glfw: terminate, clearing all previously allocated GLFW resources.
 	// ------------------------------------------------------------------
 	glfwTerminate();
+	return exitCode;
+}
+
+// CPU rendering: draws 'frames' frames at 60 Hz of the fan turning from the start camera, writes
+// the last one as software_frame.ppm and reports the throughput (or runs the regression suite)
+// ---------------------------------------------------------------------------------------
+int renderSoftware(RenderQueue& scene, RotatingPart& fanSpin, int frames)
+{
+	SoftwareBackend renderer(viewport.width, viewport.height);
+	fanSpin.start(0.0f);
+	if (regression.active)
+		return regression.run(renderer, scene, lighting) > 0 ? 1 : 0;
+
+	FrameParams frame(viewport);
+	frame.view = camera.GetViewMatrix();
+	frame.projection = viewport.projection(camera.Zoom);
+	frame.eye = camera.Position;
+
+	double milliseconds = 0.0;
+	long long triangles = 0;
+	for (int f = 0; f < frames; f++) {
+		frame.time = f / 60.0f;
+		renderer.render(scene, lighting, frame);
+		milliseconds += renderer.milliseconds;
+		triangles += renderer.trianglesRasterized;
+	}
+
+	FrameImage image;
+	renderer.requestPixels();
+	renderer.readPixels(image, true);
+	writePPM("software_frame.ppm", image.rgba, image.width, image.height);
+	printf("software: %d frames at %dx%d on %d threads, %.2f ms/frame (%.1f fps), %.2f M triangles/s (%lld of %lld submitted per frame)\n",
+		frames, image.width, image.height, renderer.threadCount(), milliseconds / frames, 1000.0 * frames / milliseconds,
+		triangles / (milliseconds * 1000.0), renderer.trianglesRasterized, renderer.trianglesSubmitted);
 	return 0;
 }
 
@@ -1296,62 +1408,76 @@ int main()
 // ---------------------------------------------------------------------------------------------------------
 void processInput(GLFWwindow* window)
 {
-	if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
+	TRACE_SCOPE("input");
+	input.beginFrame();
+
+	if (input.wasPressed(ACTION_QUIT))
 		glfwSetWindowShouldClose(window, true);
 
-	if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS) {
+	if (input.isDown(ACTION_FORWARD)) {
 		camera.ProcessKeyboard(FORWARD, deltaTime);
 	}
-	if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS) {
+	if (input.isDown(ACTION_BACKWARD)) {
 		camera.ProcessKeyboard(BACKWARD, deltaTime);
 	}
-	if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS) {
+	if (input.isDown(ACTION_LEFT)) {
 		camera.ProcessKeyboard(LEFT, deltaTime);
 	}
-	if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS) {
+	if (input.isDown(ACTION_RIGHT)) {
 		camera.ProcessKeyboard(RIGHT, deltaTime);
 	}
-	if (glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS) {
+	if (input.isDown(ACTION_UP)) {
 		camera.ProcessKeyboard(UP, deltaTime);
 	}
-	if (glfwGetKey(window, GLFW_KEY_R) == GLFW_PRESS) {
+	if (input.isDown(ACTION_DOWN)) {
 		camera.ProcessKeyboard(DOWN, deltaTime);
 	}
-	if (glfwGetKey(window, GLFW_KEY_X) == GLFW_PRESS) {
+	if (input.isDown(ACTION_PITCH_UP)) {
 		camera.ProcessKeyboard(P_UP, deltaTime);
 	}
-	if (glfwGetKey(window, GLFW_KEY_C) == GLFW_PRESS) {
+	if (input.isDown(ACTION_PITCH_DOWN)) {
 		camera.ProcessKeyboard(P_DOWN, deltaTime);
 	}
-	if (glfwGetKey(window, GLFW_KEY_Y) == GLFW_PRESS) {
+	if (input.isDown(ACTION_YAW_LEFT)) {
 		camera.ProcessKeyboard(Y_LEFT, deltaTime);
 	}
-	if (glfwGetKey(window, GLFW_KEY_V) == GLFW_PRESS) {
+	if (input.isDown(ACTION_YAW_RIGHT)) {
 		camera.ProcessKeyboard(Y_RIGHT, deltaTime);
 	}
-	if (glfwGetKey(window, GLFW_KEY_Z) == GLFW_PRESS) {
+	if (input.isDown(ACTION_ROLL_LEFT)) {
 		camera.ProcessKeyboard(R_LEFT, deltaTime);
 	}
-	if (glfwGetKey(window, GLFW_KEY_Q) == GLFW_PRESS) {
+	if (input.isDown(ACTION_ROLL_RIGHT)) {
 		camera.ProcessKeyboard(R_RIGHT, deltaTime);
 	}
-	if (glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS) {
-		if (!fan_turn) {
-			fan_turn = true;
-		}
-		else {
-			fan_turn = false;
-		}
+	// toggles flip once per key press, however long the key is held
+	if (input.wasPressed(ACTION_TOGGLE_FAN)) {
+		fan_turn = !fan_turn;
 	}
-	if (glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS) {
-		if (!rotate_around) {
-			rotate_around = true;
-		}
+	if (input.wasPressed(ACTION_TOGGLE_ORBIT)) {
+		rotate_around = !rotate_around;
+		// circle whatever is straight ahead
+		if (rotate_around)
+			camera.SetOrbitTarget(camera.Position + camera.Front * ORBIT_DISTANCE);
+	}
+	if (input.wasPressed(ACTION_TOGGLE_PREPASS)) {
+		depth_prepass = !depth_prepass;
+	}
+	if (input.wasPressed(ACTION_TOGGLE_OCCLUSION)) {
+		occlusion_culling = !occlusion_culling;
+	}
+	if (input.wasPressed(ACTION_TOGGLE_HUD)) {
+		show_hud = !show_hud;
+	}
+	// the first press starts a trace, the next ones write what has been recorded so far
+	if (input.wasPressed(ACTION_DUMP_TRACE)) {
+		if (Tracer::instance().enabled())
+			Tracer::instance().dump(trace_path);
 		else {
-			rotate_around = false;
+			Tracer::instance().start();
+			printf("trace: recording, press T again to write %s\n", trace_path.c_str());
 		}
 	}
-
 }
 
 // glfw: whenever the window size changed (by OS or user resize) this callback function executes
@@ -1361,6 +1487,8 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 	// make sure the viewport matches the new window dimensions; note that width and
 	// height will be significantly larger than specified on retina displays.
 	glViewport(0, 0, width, height);
+	viewport.resize(width, height);
+	framePacer.markDirty();
 }
 
 
@@ -1385,6 +1513,7 @@ void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
 	lastY = ypos;
 
 	camera.ProcessMouseMovement(xoffset, yoffset);
+	framePacer.markDirty();
 }
 
 // glfw: whenever the mouse scroll wheel scrolls, this callback is called
@@ -1392,4 +1521,13 @@ void mouse_callback(GLFWwindow* window, double xposIn, double yposIn)
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
 {
 	camera.ProcessMouseScroll(static_cast<float>(yoffset));
+	framePacer.markDirty();
+}
+
+// glfw: whenever a key is pressed or released, this callback is called
+// --------------------------------------------------------------------
+void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
+{
+	input.onKey(key, action);
+	framePacer.markDirty();
 }
@@ -0,0 +1,176 @@
+#pragma once
+#ifndef mesh_h
+#define mesh_h
+
+#include "shader.h"
+#include "trace.h"
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+
+// How a surface responds to light. The base colour still comes from the vertex colours.
+struct Material {
+	float ambient;
+	float diffuse;
+	float specular;
+	float shininess;
+
+	void apply(const Shader& shader) const {
+		shader.setFloat("material.ambient", ambient);
+		shader.setFloat("material.diffuse", diffuse);
+		shader.setFloat("material.specular", specular);
+		shader.setFloat("material.shininess", shininess);
+	}
+};
+
+// floats per vertex on the GPU: position (3), colour (3), normal (3)
+const int MESH_STRIDE = 9;
+
+// An indexed triangle mesh with its material and local bounds. The vertex data stays
+// on the CPU as well (the software rasteriser draws from it); VAO is 0 until uploadMesh().
+struct Mesh {
+	unsigned int VAO, VBO, EBO;
+	int indexCount;
+	Material material;
+	glm::vec3 boundsMin, boundsMax;
+	std::vector<float> vertices;		// MESH_STRIDE floats per vertex
+	std::vector<unsigned int> indices;
+};
+
+// Expands position+colour vertices (6 floats) with normals averaged from the faces that
+// use each vertex. Every mesh in the scene is convex, so face normals are oriented away
+// from the mesh centre; that makes the result independent of each array's winding.
+inline std::vector<float> addNormals(const float* vertices, int vertexCount, const unsigned int* indices, int indexCount) {
+	glm::vec3 centre(0.0f);
+	for (int v = 0; v < vertexCount; v++)
+		centre += glm::vec3(vertices[v * 6], vertices[v * 6 + 1], vertices[v * 6 + 2]);
+	centre /= static_cast<float>(vertexCount);
+
+	std::vector<glm::vec3> normals(vertexCount, glm::vec3(0.0f));
+	for (int i = 0; i + 2 < indexCount; i += 3) {
+		glm::vec3 p[3];
+		for (int k = 0; k < 3; k++) {
+			const float* v = vertices + indices[i + k] * 6;
+			p[k] = glm::vec3(v[0], v[1], v[2]);
+		}
+		// area-weighted face normal
+		glm::vec3 n = glm::cross(p[1] - p[0], p[2] - p[0]);
+		if (glm::dot(n, (p[0] + p[1] + p[2]) / 3.0f - centre) < 0.0f)
+			n = -n;
+		for (int k = 0; k < 3; k++)
+			normals[indices[i + k]] += n;
+	}
+
+	std::vector<float> result;
+	result.reserve(vertexCount * MESH_STRIDE);
+	for (int v = 0; v < vertexCount; v++) {
+		float length = glm::length(normals[v]);
+		glm::vec3 n = length > 0.0f ? normals[v] / length : glm::vec3(0.0f, 1.0f, 0.0f);
+		result.insert(result.end(), vertices + v * 6, vertices + v * 6 + 6);
+		result.push_back(n.x);
+		result.push_back(n.y);
+		result.push_back(n.z);
+	}
+	return result;
+}
+
+// Builds a mesh from a position+colour array and its indices on the CPU; sizes are in
+// bytes, as passed to glBufferData (sizeof of the arrays). Needs no GL context.
+inline Mesh buildMesh(const float* vertices, size_t verticesSize, const unsigned int* indices, size_t indicesSize, const Material& material) {
+	int vertexCount = static_cast<int>(verticesSize / (6 * sizeof(float)));
+	int indexCount = static_cast<int>(indicesSize / sizeof(unsigned int));
+
+	Mesh mesh;
+	mesh.VAO = mesh.VBO = mesh.EBO = 0;
+	mesh.vertices = addNormals(vertices, vertexCount, indices, indexCount);
+	mesh.indices.assign(indices, indices + indexCount);
+	mesh.indexCount = indexCount;
+	mesh.material = material;
+	mesh.boundsMin = glm::vec3(vertices[0], vertices[1], vertices[2]);
+	mesh.boundsMax = mesh.boundsMin;
+	for (int v = 1; v < vertexCount; v++) {
+		glm::vec3 p(vertices[v * 6], vertices[v * 6 + 1], vertices[v * 6 + 2]);
+		mesh.boundsMin = glm::min(mesh.boundsMin, p);
+		mesh.boundsMax = glm::max(mesh.boundsMax, p);
+	}
+	return mesh;
+}
+
+// Appends 'source' as placed by 'model' to 'target', in target's space: positions and
+// normals are transformed (normals as the vertex shader does it, unnormalised), colours
+// are kept, and target's bounds grow to fit. Needs no GL context.
+inline void appendMesh(Mesh& target, const Mesh& source, const glm::mat4& model) {
+	glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(model)));
+	unsigned int first = static_cast<unsigned int>(target.vertices.size() / MESH_STRIDE);
+	if (first == 0) {
+		target.boundsMin = glm::vec3(1e30f);
+		target.boundsMax = glm::vec3(-1e30f);
+	}
+	target.vertices.reserve(target.vertices.size() + source.vertices.size());
+	for (size_t v = 0; v + MESH_STRIDE <= source.vertices.size(); v += MESH_STRIDE) {
+		const float* in = &source.vertices[v];
+		glm::vec3 p = glm::vec3(model * glm::vec4(in[0], in[1], in[2], 1.0f));
+		glm::vec3 n = normalMatrix * glm::vec3(in[6], in[7], in[8]);
+		float out[MESH_STRIDE] = { p.x, p.y, p.z, in[3], in[4], in[5], n.x, n.y, n.z };
+		target.vertices.insert(target.vertices.end(), out, out + MESH_STRIDE);
+		target.boundsMin = glm::min(target.boundsMin, p);
+		target.boundsMax = glm::max(target.boundsMax, p);
+	}
+	for (int i = 0; i < source.indexCount; i++)
+		target.indices.push_back(first + source.indices[i]);
+	target.indexCount = static_cast<int>(target.indices.size());
+}
+
+// creates the GL buffers for a built mesh; needs a current context
+inline void uploadMesh(Mesh& mesh) {
+	TRACE_SCOPE("upload mesh");
+	glGenVertexArrays(1, &mesh.VAO);
+	glGenBuffers(1, &mesh.VBO);
+	glGenBuffers(1, &mesh.EBO);
+	glBindVertexArray(mesh.VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, mesh.VBO);
+	glBufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(float), mesh.vertices.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.EBO);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(unsigned int), mesh.indices.data(), GL_STATIC_DRAW);
+	// position attribute
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, MESH_STRIDE * sizeof(float), (void*)0);
+	glEnableVertexAttribArray(0);
+	//color attribute
+	glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, MESH_STRIDE * sizeof(float), (void*)(3 * sizeof(float)));
+	glEnableVertexAttribArray(1);
+	//normal attribute
+	glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, MESH_STRIDE * sizeof(float), (void*)(6 * sizeof(float)));
+	glEnableVertexAttribArray(2);
+	glBindVertexArray(0);
+}
+
+inline Mesh createMesh(const float* vertices, size_t verticesSize, const unsigned int* indices, size_t indicesSize, const Material& material) {
+	Mesh mesh = buildMesh(vertices, verticesSize, indices, indicesSize, material);
+	uploadMesh(mesh);
+	return mesh;
+}
+
+inline void deleteMesh(Mesh& mesh) {
+	glDeleteVertexArrays(1, &mesh.VAO);
+	glDeleteBuffers(1, &mesh.VBO);
+	glDeleteBuffers(1, &mesh.EBO);
+	mesh.VAO = mesh.VBO = mesh.EBO = 0;
+}
+
+// sets the per-draw uniforms (model, normal matrix, material) and draws the whole mesh
+inline void drawMesh(const Shader& shader, const Mesh& mesh, const glm::mat4& model) {
+	shader.setMat4("model", model);
+	shader.setMat3("normalMatrix", glm::transpose(glm::inverse(glm::mat3(model))));
+	mesh.material.apply(shader);
+	glBindVertexArray(mesh.VAO);
+	glDrawElements(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, 0);
+}
+
+// depth-only passes: just the model matrix
+inline void drawMeshDepth(const Shader& shader, const Mesh& mesh, const glm::mat4& model) {
+	shader.setMat4("model", model);
+	glBindVertexArray(mesh.VAO);
+	glDrawElements(GL_TRIANGLES, mesh.indexCount, GL_UNSIGNED_INT, 0);
+}
+
+#endif
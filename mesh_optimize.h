@@ -0,0 +1,293 @@
+#pragma once
+#ifndef mesh_optimize_h
+#define mesh_optimize_h
+
+#include "mesh.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cstdio>
+#include <vector>
+
+// FIFO post-transform cache the orderings are tuned for and measured against
+const int VERTEX_CACHE_SIZE = 16;
+// overdraw clusters are cut where their own ACMR is within this factor of the mesh's
+const float OVERDRAW_THRESHOLD = 1.05f;
+
+// Average cache miss ratio: vertex shader runs per triangle through a FIFO cache of
+// 'cacheSize' entries. 0.5 is the ideal for large grids, 3.0 means no reuse at all.
+inline float meshACMR(const std::vector<unsigned int>& indices, int vertexCount, int cacheSize = VERTEX_CACHE_SIZE) {
+	if (indices.size() < 3)
+		return 0.0f;
+	// a vertex is cached while fewer than cacheSize misses happened since it was loaded
+	std::vector<long long> loaded(vertexCount, -1000000);
+	long long misses = 0;
+	for (size_t i = 0; i < indices.size(); i++) {
+		unsigned int v = indices[i];
+		if (misses - loaded[v] >= cacheSize) {
+			loaded[v] = misses;
+			misses++;
+		}
+	}
+	return static_cast<float>(misses) / static_cast<float>(indices.size() / 3);
+}
+
+// Tipsify (Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality
+// and Reduced Overdraw", 2007): fans around one vertex at a time, moving on to the
+// adjacent vertex that will still be cached and has the fewest triangles left.
+// 'hardBoundaries' gets the first triangle of every run that started cold (after a dead end).
+inline std::vector<unsigned int> tipsify(const std::vector<unsigned int>& indices, int vertexCount, int cacheSize, std::vector<int>& hardBoundaries) {
+	int triangleCount = static_cast<int>(indices.size() / 3);
+	// triangles around each vertex
+	std::vector<int> live(vertexCount, 0), offsets(vertexCount + 1, 0), adjacency(triangleCount * 3);
+	for (int i = 0; i < triangleCount * 3; i++)
+		live[indices[i]]++;
+	for (int v = 0; v < vertexCount; v++)
+		offsets[v + 1] = offsets[v] + live[v];
+	std::vector<int> fill(offsets.begin(), offsets.end() - 1);
+	for (int i = 0; i < triangleCount * 3; i++)
+		adjacency[fill[indices[i]]++] = i / 3;
+
+	std::vector<int> cacheTime(vertexCount, 0), deadEnd, candidates;
+	std::vector<bool> emitted(triangleCount, false);
+	std::vector<unsigned int> result;
+	result.reserve(triangleCount * 3);
+	int time = cacheSize + 1, cursor = 0;
+	int fanning = 0;
+	while (fanning < vertexCount && live[fanning] == 0)
+		fanning++;
+	bool cold = true;
+	while (fanning < vertexCount) {
+		if (cold) {
+			hardBoundaries.push_back(static_cast<int>(result.size() / 3));
+			cold = false;
+		}
+		candidates.clear();
+		for (int a = offsets[fanning]; a < offsets[fanning + 1]; a++) {
+			int t = adjacency[a];
+			if (emitted[t])
+				continue;
+			for (int k = 0; k < 3; k++) {
+				unsigned int v = indices[t * 3 + k];
+				result.push_back(v);
+				deadEnd.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+				if (time - cacheTime[v] > cacheSize)
+					cacheTime[v] = time++;
+			}
+			emitted[t] = true;
+		}
+
+		// the oldest candidate that stays cached through its remaining fan
+		int next = -1, best = 0;
+		for (size_t c = 0; c < candidates.size(); c++) {
+			int v = candidates[c];
+			if (live[v] == 0)
+				continue;
+			int priority = time - cacheTime[v] + 2 * live[v] <= cacheSize ? time - cacheTime[v] : 0;
+			if (priority > best) {
+				best = priority;
+				next = v;
+			}
+		}
+		if (next < 0) {
+			// dead end: the most recently used vertex with triangles left, else the next in order
+			while (!deadEnd.empty() && next < 0) {
+				int v = deadEnd.back();
+				deadEnd.pop_back();
+				if (live[v] > 0)
+					next = v;
+			}
+			while (next < 0 && cursor < vertexCount) {
+				if (live[cursor] > 0)
+					next = cursor;
+				cursor++;
+			}
+			cold = true;
+		}
+		fanning = next < 0 ? vertexCount : next;
+	}
+	return result;
+}
+
+// Splits the cache-ordered triangles into clusters (at every hard boundary, and wherever a
+// cluster's own ACMR has come within 'threshold' of the whole mesh's) and draws the
+// clusters facing furthest out first, so that they occlude the rest of the mesh. Normals
+// come from the vertices, which buildMesh() orients away from the mesh centre.
+inline std::vector<unsigned int> sortForOverdraw(const Mesh& mesh, const std::vector<unsigned int>& indices, const std::vector<int>& hardBoundaries, float threshold, int cacheSize) {
+	int vertexCount = static_cast<int>(mesh.vertices.size() / MESH_STRIDE);
+	int triangleCount = static_cast<int>(indices.size() / 3);
+	float target = meshACMR(indices, vertexCount, cacheSize) * threshold;
+
+	std::vector<int> starts;
+	std::vector<long long> loaded(vertexCount, -1000000);
+	size_t hard = 0;
+	long long misses = 0, clusterMisses = 0;
+	int clusterStart = 0;
+	for (int t = 0; t < triangleCount; t++) {
+		bool cut = hard < hardBoundaries.size() && hardBoundaries[hard] == t;
+		if (cut)
+			hard++;
+		else if (t > clusterStart && static_cast<float>(clusterMisses) / (t - clusterStart) <= target)
+			cut = true;
+		if (cut || t == 0) {
+			starts.push_back(t);
+			clusterStart = t;
+			clusterMisses = 0;
+		}
+		for (int k = 0; k < 3; k++) {
+			unsigned int v = indices[t * 3 + k];
+			if (misses - loaded[v] >= cacheSize) {
+				loaded[v] = misses++;
+				clusterMisses++;
+			}
+		}
+	}
+	starts.push_back(triangleCount);
+
+	glm::vec3 centre = (mesh.boundsMin + mesh.boundsMax) * 0.5f;
+	std::vector<std::pair<float, int> > clusters;
+	for (size_t c = 0; c + 1 < starts.size(); c++) {
+		glm::vec3 position(0.0f), normal(0.0f);
+		for (int i = starts[c] * 3; i < starts[c + 1] * 3; i++) {
+			const float* v = &mesh.vertices[indices[i] * MESH_STRIDE];
+			position += glm::vec3(v[0], v[1], v[2]);
+			normal += glm::vec3(v[6], v[7], v[8]);
+		}
+		position /= static_cast<float>((starts[c + 1] - starts[c]) * 3);
+		clusters.push_back(std::make_pair(-glm::dot(position - centre, normal), static_cast<int>(c)));
+	}
+	std::stable_sort(clusters.begin(), clusters.end());
+
+	std::vector<unsigned int> result;
+	result.reserve(indices.size());
+	for (size_t c = 0; c < clusters.size(); c++) {
+		int cluster = clusters[c].second;
+		result.insert(result.end(), indices.begin() + starts[cluster] * 3, indices.begin() + starts[cluster + 1] * 3);
+	}
+	return result;
+}
+
+// Renumbers the vertices in the order the indices first use them, so that vertex fetches
+// walk the buffer forwards. Vertices no triangle uses keep their order at the end.
+inline void optimizeVertexFetch(Mesh& mesh) {
+	int vertexCount = static_cast<int>(mesh.vertices.size() / MESH_STRIDE);
+	std::vector<int> remap(vertexCount, -1);
+	int next = 0;
+	for (size_t i = 0; i < mesh.indices.size(); i++) {
+		if (remap[mesh.indices[i]] < 0)
+			remap[mesh.indices[i]] = next++;
+		mesh.indices[i] = remap[mesh.indices[i]];
+	}
+	for (int v = 0; v < vertexCount; v++)
+		if (remap[v] < 0)
+			remap[v] = next++;
+	std::vector<float> vertices(mesh.vertices.size());
+	for (int v = 0; v < vertexCount; v++)
+		std::copy(mesh.vertices.begin() + v * MESH_STRIDE, mesh.vertices.begin() + (v + 1) * MESH_STRIDE,
+			vertices.begin() + remap[v] * MESH_STRIDE);
+	mesh.vertices.swap(vertices);
+}
+
+struct MeshWeldResult {
+	int verticesBefore, verticesAfter;
+	int bytesSaved;
+};
+
+// Cleanup before optimizeMesh(): vertices equal in every attribute (position, colour and
+// the normal buildMesh() gave them) are welded into one and vertices no triangle uses are
+// dropped; vertices that share a position but differ in anything else stay split. Runs
+// after normals are generated so shading is unchanged. With a 'name' the savings are printed.
+inline MeshWeldResult weldMesh(Mesh& mesh, const char* name) {
+	int vertexCount = static_cast<int>(mesh.vertices.size() / MESH_STRIDE);
+	mesh.indices.resize(mesh.indexCount);
+	std::vector<bool> used(vertexCount, false);
+	for (size_t i = 0; i < mesh.indices.size(); i++)
+		used[mesh.indices[i]] = true;
+
+	// sort the used vertices by their attributes; equal ones end up next to each other
+	std::vector<int> sorted;
+	for (int v = 0; v < vertexCount; v++)
+		if (used[v])
+			sorted.push_back(v);
+	const float* data = mesh.vertices.data();
+	std::stable_sort(sorted.begin(), sorted.end(), [data](int a, int b) {
+		return std::lexicographical_compare(data + a * MESH_STRIDE, data + (a + 1) * MESH_STRIDE,
+			data + b * MESH_STRIDE, data + (b + 1) * MESH_STRIDE);
+	});
+	std::vector<int> remap(vertexCount, -1);
+	for (size_t s = 0; s < sorted.size(); s++) {
+		int v = sorted[s];
+		if (s > 0 && std::equal(data + v * MESH_STRIDE, data + (v + 1) * MESH_STRIDE, data + sorted[s - 1] * MESH_STRIDE))
+			remap[v] = remap[sorted[s - 1]];
+		else
+			remap[v] = v;
+	}
+
+	// keep the first of every welded set in the original order
+	std::vector<int> renumber(vertexCount, -1);
+	std::vector<float> vertices;
+	vertices.reserve(mesh.vertices.size());
+	int kept = 0;
+	for (int v = 0; v < vertexCount; v++) {
+		if (remap[v] != v)
+			continue;
+		renumber[v] = kept++;
+		vertices.insert(vertices.end(), data + v * MESH_STRIDE, data + (v + 1) * MESH_STRIDE);
+	}
+	for (size_t i = 0; i < mesh.indices.size(); i++)
+		mesh.indices[i] = renumber[remap[mesh.indices[i]]];
+	mesh.vertices.swap(vertices);
+	if (kept > 0) {
+		mesh.boundsMin = glm::vec3(1e30f);
+		mesh.boundsMax = glm::vec3(-1e30f);
+		for (int v = 0; v < kept; v++) {
+			glm::vec3 p(mesh.vertices[v * MESH_STRIDE], mesh.vertices[v * MESH_STRIDE + 1], mesh.vertices[v * MESH_STRIDE + 2]);
+			mesh.boundsMin = glm::min(mesh.boundsMin, p);
+			mesh.boundsMax = glm::max(mesh.boundsMax, p);
+		}
+	}
+
+	MeshWeldResult result = { vertexCount, kept, (vertexCount - kept) * MESH_STRIDE * static_cast<int>(sizeof(float)) };
+	if (name)
+		printf("mesh weld:     %-16s %5d -> %5d vertices, %d bytes saved\n", name, result.verticesBefore, result.verticesAfter, result.bytesSaved);
+	return result;
+}
+
+struct MeshOptimizeResult {
+	float acmrBefore, acmrAfter;
+	int triangles;
+};
+
+// Load-time pass over a built mesh, before uploadMesh(): triangles reordered for the
+// vertex cache, then clustered against overdraw (skipped when 'overdrawThreshold' <= 0),
+// then vertices renumbered for fetch locality. The ordering is only kept if it measures
+// no worse than the original. With a 'name' the ACMR before and after is printed.
+inline MeshOptimizeResult optimizeMesh(Mesh& mesh, const char* name, float overdrawThreshold = OVERDRAW_THRESHOLD, int cacheSize = VERTEX_CACHE_SIZE) {
+	int vertexCount = static_cast<int>(mesh.vertices.size() / MESH_STRIDE);
+	mesh.indices.resize(mesh.indexCount);
+	MeshOptimizeResult result;
+	result.triangles = mesh.indexCount / 3;
+	result.acmrBefore = result.acmrAfter = meshACMR(mesh.indices, vertexCount, cacheSize);
+	if (result.triangles > 1) {
+		std::vector<int> hardBoundaries;
+		std::vector<unsigned int> indices = tipsify(mesh.indices, vertexCount, cacheSize, hardBoundaries);
+		if (overdrawThreshold > 0.0f) {
+			// the overdraw order may cost some cache efficiency, up to the threshold
+			std::vector<unsigned int> sorted = sortForOverdraw(mesh, indices, hardBoundaries, overdrawThreshold, cacheSize);
+			if (meshACMR(sorted, vertexCount, cacheSize) <= meshACMR(indices, vertexCount, cacheSize) * overdrawThreshold)
+				indices.swap(sorted);
+		}
+		float acmr = meshACMR(indices, vertexCount, cacheSize);
+		if (acmr <= result.acmrBefore) {
+			mesh.indices.swap(indices);
+			result.acmrAfter = acmr;
+		}
+		optimizeVertexFetch(mesh);
+	}
+	if (name)
+		printf("mesh optimise: %-16s %5d triangles, ACMR %.3f -> %.3f\n", name, result.triangles, result.acmrBefore, result.acmrAfter);
+	return result;
+}
+
+#endif
@@ -0,0 +1,144 @@
+#pragma once
+#ifndef occlusion_h
+#define occlusion_h
+
+#include "shader.h"
+#include "render_queue.h"
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <vector>
+
+// world units added around every group's bounds before it is tested
+const float OCCLUSION_BOX_MARGIN = 0.05f;
+
+// Occlusion culling for the scene's furniture groups with hardware queries. After the
+// frame's opaque pass each group's bounding box is drawn against the finished depth
+// buffer inside a GL_ANY_SAMPLES_PASSED query (no colour or depth writes); next frame
+// the group's draws run under conditional rendering on that query, so a table, tool or
+// glass hidden behind the bar or the rack is dropped by the GPU without the CPU ever
+// waiting for a result. The price is one frame of latency: a group that comes into
+// view is drawn from the frame after, which the slightly inflated boxes mostly hide.
+class OcclusionCuller {
+
+public:
+	bool enabled;
+	// groups whose latest available result said hidden (for the title / HUD), and their draws
+	int hiddenGroups;
+	int hiddenDraws;
+
+	OcclusionCuller() : enabled(true), hiddenGroups(0), hiddenDraws(0), VAO(0), VBO(0), EBO(0) {
+	}
+
+	void init(RenderQueue& scene) {
+		for (size_t g = 0; g < scene.groups.size(); g++) {
+			glGenQueries(1, &scene.groups[g].query);
+			scene.groups[g].tested = false;
+		}
+		hidden.assign(scene.groups.size(), 0);
+
+		// unit cube, scaled onto each group's bounds
+		float corners[] = {
+			0.0f, 0.0f, 0.0f,  1.0f, 0.0f, 0.0f,  1.0f, 1.0f, 0.0f,  0.0f, 1.0f, 0.0f,
+			0.0f, 0.0f, 1.0f,  1.0f, 0.0f, 1.0f,  1.0f, 1.0f, 1.0f,  0.0f, 1.0f, 1.0f
+		};
+		unsigned int faces[] = {
+			0, 1, 2,  2, 3, 0,   4, 5, 6,  6, 7, 4,   0, 1, 5,  5, 4, 0,
+			3, 2, 6,  6, 7, 3,   0, 3, 7,  7, 4, 0,   1, 2, 6,  6, 5, 1
+		};
+		glGenVertexArrays(1, &VAO);
+		glGenBuffers(1, &VBO);
+		glGenBuffers(1, &EBO);
+		glBindVertexArray(VAO);
+		glBindBuffer(GL_ARRAY_BUFFER, VBO);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(faces), faces, GL_STATIC_DRAW);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+		glEnableVertexAttribArray(0);
+		glBindVertexArray(0);
+	}
+
+	void release(RenderQueue& scene) {
+		for (size_t g = 0; g < scene.groups.size(); g++) {
+			glDeleteQueries(1, &scene.groups[g].query);
+			scene.groups[g].query = 0;
+			scene.groups[g].tested = false;
+		}
+		glDeleteVertexArrays(1, &VAO);
+		glDeleteBuffers(1, &VBO);
+		glDeleteBuffers(1, &EBO);
+	}
+
+	// call after the opaque pass, with the frame's depth buffer still bound; issues
+	// the queries next frame's draws are conditional on
+	void query(RenderQueue& scene, const Shader& depthShader, const glm::mat4& view, const glm::mat4& projection, const glm::vec3& eye) {
+		collect(scene);
+		if (!enabled) {
+			for (size_t g = 0; g < scene.groups.size(); g++)
+				scene.groups[g].tested = false;
+			return;
+		}
+
+		depthShader.use();
+		depthShader.setMat4("view", view);
+		depthShader.setMat4("projection", projection);
+		RotatingPart::clear(depthShader);
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		glDepthMask(GL_FALSE);
+		glBindVertexArray(VAO);
+		for (size_t g = 0; g < scene.groups.size(); g++) {
+			DrawGroup& group = scene.groups[g];
+			glm::vec3 lo = group.boundsMin - glm::vec3(OCCLUSION_BOX_MARGIN), hi = group.boundsMax + glm::vec3(OCCLUSION_BOX_MARGIN);
+			// from inside (or touching) the box its faces can be clipped away: always draw
+			if (contains(lo - glm::vec3(0.2f), hi + glm::vec3(0.2f), eye)) {
+				group.tested = false;
+				continue;
+			}
+			depthShader.setMat4("model", glm::scale(glm::translate(glm::mat4(1.0f), lo), hi - lo));
+			glBeginQuery(GL_ANY_SAMPLES_PASSED, group.query);
+			glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+			glEndQuery(GL_ANY_SAMPLES_PASSED);
+			group.tested = true;
+			scene.stats.drawCalls++;
+			scene.stats.triangles += 12;
+		}
+		glBindVertexArray(0);
+		glDepthMask(GL_TRUE);
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	}
+
+private:
+	unsigned int VAO, VBO, EBO;
+	std::vector<char> hidden;
+
+	static bool contains(const glm::vec3& lo, const glm::vec3& hi, const glm::vec3& p) {
+		return p.x >= lo.x && p.y >= lo.y && p.z >= lo.z && p.x <= hi.x && p.y <= hi.y && p.z <= hi.z;
+	}
+
+	// reads whichever of last frame's results are already available (never waits)
+	void collect(const RenderQueue& scene) {
+		hiddenGroups = 0;
+		for (size_t g = 0; g < scene.groups.size(); g++) {
+			const DrawGroup& group = scene.groups[g];
+			if (group.tested) {
+				GLint available = 0;
+				glGetQueryObjectiv(group.query, GL_QUERY_RESULT_AVAILABLE, &available);
+				if (available) {
+					GLuint anySamples = 0;
+					glGetQueryObjectuiv(group.query, GL_QUERY_RESULT, &anySamples);
+					hidden[g] = anySamples == 0;
+				}
+			}
+			else
+				hidden[g] = 0;
+			hiddenGroups += hidden[g];
+		}
+		hiddenDraws = 0;
+		for (size_t i = 0; i < scene.items.size(); i++)
+			if (scene.items[i].group >= 0 && hidden[scene.items[i].group])
+				hiddenDraws++;
+	}
+};
+
+#endif
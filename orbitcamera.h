@@ -26,11 +26,11 @@ public:
         Phi = glm::clamp(Phi + dPhi, 0.1f, glm::radians(179.9f));  // Avoids gimbal lock
     }
 
-    // Calculate the camera's position from the target
+    // Calculate the camera's position from the target (Phi is measured from +y, the scene's up)
     glm::vec3 GetPosition() const {
         float x = Distance * sin(Phi) * cos(Theta);
-        float y = Distance * sin(Phi) * sin(Theta);
-        float z = Distance * cos(Phi);
+        float y = Distance * cos(Phi);
+        float z = Distance * sin(Phi) * sin(Theta);
         return Target + glm::vec3(x, y, z);
     }
 
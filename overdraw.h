@@ -0,0 +1,65 @@
+#pragma once
+#ifndef overdraw_h
+#define overdraw_h
+
+#include "viewport.h"
+#include <glad/glad.h>
+
+// Counts how many fragments pass the depth test in the shaded pass (GL_SAMPLES_PASSED)
+// relative to the number of pixels: 1.0 means every pixel was lit exactly once,
+// anything above is overdraw paid for in fragment shading. Queries alternate between
+// two objects and a result is only read once it is available, so measuring never
+// stalls the pipeline; the figure lags a frame or two behind.
+class OverdrawCounter {
+
+public:
+	double ratio;	// shaded fragments per pixel, from the latest available frame
+
+	OverdrawCounter() : ratio(0.0), current(0), pixels(0) {
+		queries[0] = queries[1] = 0;
+		pending[0] = pending[1] = 0;
+	}
+
+	void init() {
+		glGenQueries(2, queries);
+	}
+	void release() {
+		glDeleteQueries(2, queries);
+	}
+
+	void begin(const Viewport& viewport) {
+		// the older query's object is about to be reused: its result has to be read now
+		collect(current, true);
+		pixels = static_cast<double>(viewport.width) * viewport.height;
+		glBeginQuery(GL_SAMPLES_PASSED, queries[current]);
+	}
+	void end() {
+		glEndQuery(GL_SAMPLES_PASSED);
+		pending[current] = pixels;
+		current ^= 1;
+		// last frame's query, if the GPU is already done with it
+		collect(current, false);
+	}
+
+private:
+	unsigned int queries[2];
+	double pending[2];	// pixel count of the frame a query measured, 0 when nothing is pending
+	int current;
+	double pixels;
+
+	void collect(int index, bool wait) {
+		if (pending[index] <= 0.0)
+			return;
+		GLint available = 0;
+		if (!wait)
+			glGetQueryObjectiv(queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!wait && !available)
+			return;
+		GLuint samples = 0;
+		glGetQueryObjectuiv(queries[index], GL_QUERY_RESULT, &samples);
+		ratio = samples / pending[index];
+		pending[index] = 0.0;
+	}
+};
+
+#endif
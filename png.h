@@ -0,0 +1,494 @@
+#pragma once
+#ifndef png_h
+#define png_h
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+// Just enough PNG for reference images, without pulling in zlib. Writing produces 8-bit
+// RGBA with the Sub filter and fixed-Huffman deflate (a hashed LZ77 matcher finds the
+// repeats); reading accepts 8-bit grey, grey+alpha, RGB and RGBA without interlacing,
+// whichever tool compressed them. Pixels are RGBA rows, bottom row first (glReadPixels order).
+
+// deflate length (257..285) and distance (0..29) codes: base values and extra bits
+const unsigned short DEFLATE_LENGTH_BASE[29] = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+	35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+const unsigned char DEFLATE_LENGTH_EXTRA[29] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+	3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+const unsigned short DEFLATE_DISTANCE_BASE[30] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+	257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+const unsigned char DEFLATE_DISTANCE_EXTRA[30] = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+	7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+const int DEFLATE_WINDOW = 32768;
+const int DEFLATE_MAX_MATCH = 258;
+
+struct Crc32Table {
+	unsigned int entries[256];
+
+	Crc32Table() {
+		for (unsigned int n = 0; n < 256; n++) {
+			unsigned int c = n;
+			for (int k = 0; k < 8; k++)
+				c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+			entries[n] = c;
+		}
+	}
+};
+
+// chunk checksum; pass the previous result to continue over several buffers
+inline unsigned int pngCrc(const unsigned char* data, size_t size, unsigned int crc = 0) {
+	static const Crc32Table table;
+	crc = ~crc;
+	for (size_t i = 0; i < size; i++)
+		crc = table.entries[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+	return ~crc;
+}
+
+// Writes a raw deflate stream, least significant bit first
+class DeflateWriter {
+
+public:
+	std::vector<unsigned char> bytes;
+
+	DeflateWriter() : buffer(0), filled(0) {
+	}
+
+	// compresses 'data' as a single fixed-Huffman block
+	void compress(const std::vector<unsigned char>& data) {
+		bits(1, 1);	// final block
+		bits(1, 2);	// fixed codes
+		std::vector<int> head(1 << 15, -1);	// most recent position of each 3-byte hash
+		size_t size = data.size();
+		size_t i = 0;
+		while (i < size) {
+			int length = 0, distance = 0;
+			if (i + 2 < size) {
+				int& candidate = head[hash(&data[i])];
+				if (candidate >= 0 && i - candidate <= static_cast<size_t>(DEFLATE_WINDOW)) {
+					size_t limit = std::min(size - i, static_cast<size_t>(DEFLATE_MAX_MATCH));
+					size_t n = 0;
+					while (n < limit && data[candidate + n] == data[i + n])
+						n++;
+					if (n >= 3) {
+						length = static_cast<int>(n);
+						distance = static_cast<int>(i - candidate);
+					}
+				}
+				candidate = static_cast<int>(i);
+			}
+			if (length == 0) {
+				symbol(data[i]);
+				i++;
+				continue;
+			}
+			match(length, distance);
+			// remember the positions inside the match too, they start later matches
+			for (size_t k = i + 1; k < i + length && k + 2 < size; k++)
+				head[hash(&data[k])] = static_cast<int>(k);
+			i += length;
+		}
+		symbol(256);
+		if (filled > 0)
+			bytes.push_back(static_cast<unsigned char>(buffer));
+		buffer = 0;
+		filled = 0;
+	}
+
+private:
+	unsigned int buffer;
+	int filled;
+
+	static int hash(const unsigned char* p) {
+		return ((p[0] << 10) ^ (p[1] << 5) ^ p[2]) & 0x7fff;
+	}
+
+	void bits(unsigned int value, int count) {
+		buffer |= value << filled;
+		filled += count;
+		while (filled >= 8) {
+			bytes.push_back(static_cast<unsigned char>(buffer & 0xff));
+			buffer >>= 8;
+			filled -= 8;
+		}
+	}
+	// Huffman codes are defined most significant bit first
+	void code(unsigned int value, int length) {
+		unsigned int reversed = 0;
+		for (int b = 0; b < length; b++)
+			reversed |= ((value >> b) & 1) << (length - 1 - b);
+		bits(reversed, length);
+	}
+	// the fixed literal/length code of RFC 1951, 3.2.6
+	void symbol(int s) {
+		if (s < 144)
+			code(0x30 + s, 8);
+		else if (s < 256)
+			code(0x190 + s - 144, 9);
+		else if (s < 280)
+			code(s - 256, 7);
+		else
+			code(0xc0 + s - 280, 8);
+	}
+	void match(int length, int distance) {
+		int l = 28;
+		while (DEFLATE_LENGTH_BASE[l] > length)
+			l--;
+		symbol(257 + l);
+		bits(length - DEFLATE_LENGTH_BASE[l], DEFLATE_LENGTH_EXTRA[l]);
+		int d = 29;
+		while (DEFLATE_DISTANCE_BASE[d] > distance)
+			d--;
+		code(d, 5);
+		bits(distance - DEFLATE_DISTANCE_BASE[d], DEFLATE_DISTANCE_EXTRA[d]);
+	}
+};
+
+// Decodes a raw deflate stream (stored, fixed and dynamic blocks), after RFC 1951 and
+// Mark Adler's puff: canonical Huffman codes decoded one bit at a time.
+class Inflater {
+
+public:
+	Inflater(const unsigned char* data, size_t size) : in(data), size(size), pos(0), buffer(0), filled(0), failed(false) {
+	}
+
+	bool run(std::vector<unsigned char>& out) {
+		int last = 0;
+		while (!last && !failed) {
+			last = bits(1);
+			int type = bits(2);
+			if (type == 0)
+				stored(out);
+			else if (type == 1)
+				fixed(out);
+			else if (type == 2)
+				dynamic(out);
+			else
+				failed = true;
+		}
+		return !failed;
+	}
+
+private:
+	struct Huffman {
+		short counts[16];	// codes of each length
+		short symbols[288];	// symbols ordered by code
+	};
+
+	const unsigned char* in;
+	size_t size, pos;
+	unsigned int buffer;
+	int filled;
+	bool failed;
+
+	int bits(int need) {
+		while (filled < need) {
+			if (pos >= size) {
+				failed = true;
+				return 0;
+			}
+			buffer |= static_cast<unsigned int>(in[pos++]) << filled;
+			filled += 8;
+		}
+		int value = static_cast<int>(buffer & ((1u << need) - 1));
+		buffer >>= need;
+		filled -= need;
+		return value;
+	}
+
+	static void build(Huffman& h, const unsigned char* lengths, int n) {
+		short offsets[16];
+		for (int len = 0; len < 16; len++)
+			h.counts[len] = 0;
+		for (int s = 0; s < n; s++)
+			h.counts[lengths[s]]++;
+		offsets[1] = 0;
+		for (int len = 1; len < 15; len++)
+			offsets[len + 1] = offsets[len] + h.counts[len];
+		for (int s = 0; s < n; s++)
+			if (lengths[s] != 0)
+				h.symbols[offsets[lengths[s]]++] = static_cast<short>(s);
+	}
+
+	int decode(const Huffman& h) {
+		int code = 0, first = 0, index = 0;
+		for (int len = 1; len < 16; len++) {
+			code |= bits(1);
+			int count = h.counts[len];
+			if (code - count < first)
+				return h.symbols[index + (code - first)];
+			index += count;
+			first = (first + count) << 1;
+			code <<= 1;
+		}
+		failed = true;
+		return 0;
+	}
+
+	void stored(std::vector<unsigned char>& out) {
+		buffer = 0;
+		filled = 0;
+		if (pos + 4 > size) {
+			failed = true;
+			return;
+		}
+		size_t length = in[pos] | (in[pos + 1] << 8);
+		pos += 4;
+		if (pos + length > size) {
+			failed = true;
+			return;
+		}
+		out.insert(out.end(), in + pos, in + pos + length);
+		pos += length;
+	}
+
+	void codes(std::vector<unsigned char>& out, const Huffman& lengthCode, const Huffman& distanceCode) {
+		while (!failed) {
+			int s = decode(lengthCode);
+			if (s < 256) {
+				out.push_back(static_cast<unsigned char>(s));
+				continue;
+			}
+			if (s == 256)
+				return;
+			s -= 257;
+			if (s >= 29) {
+				failed = true;
+				return;
+			}
+			size_t length = DEFLATE_LENGTH_BASE[s] + bits(DEFLATE_LENGTH_EXTRA[s]);
+			int d = decode(distanceCode);
+			if (d >= 30) {
+				failed = true;
+				return;
+			}
+			size_t distance = DEFLATE_DISTANCE_BASE[d] + bits(DEFLATE_DISTANCE_EXTRA[d]);
+			if (distance > out.size()) {
+				failed = true;
+				return;
+			}
+			// byte by byte: the source may overlap what is being written
+			for (size_t k = 0; k < length; k++)
+				out.push_back(out[out.size() - distance]);
+		}
+	}
+
+	void fixed(std::vector<unsigned char>& out) {
+		unsigned char lengths[288];
+		for (int s = 0; s < 288; s++)
+			lengths[s] = s < 144 ? 8 : s < 256 ? 9 : s < 280 ? 7 : 8;
+		Huffman lengthCode, distanceCode;
+		build(lengthCode, lengths, 288);
+		for (int s = 0; s < 30; s++)
+			lengths[s] = 5;
+		build(distanceCode, lengths, 30);
+		codes(out, lengthCode, distanceCode);
+	}
+
+	void dynamic(std::vector<unsigned char>& out) {
+		static const unsigned char order[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+		int lengthCount = bits(5) + 257;
+		int distanceCount = bits(5) + 1;
+		int codeCount = bits(4) + 4;
+		if (lengthCount > 286 || distanceCount > 30) {
+			failed = true;
+			return;
+		}
+		unsigned char lengths[320] = { 0 };
+		for (int i = 0; i < codeCount; i++)
+			lengths[order[i]] = static_cast<unsigned char>(bits(3));
+		Huffman lengthCode, distanceCode;
+		build(lengthCode, lengths, 19);
+
+		int i = 0;
+		while (i < lengthCount + distanceCount && !failed) {
+			int s = decode(lengthCode);
+			if (s < 16) {
+				lengths[i++] = static_cast<unsigned char>(s);
+				continue;
+			}
+			unsigned char value = 0;
+			int repeat;
+			if (s == 16) {
+				if (i == 0) {
+					failed = true;
+					return;
+				}
+				value = lengths[i - 1];
+				repeat = 3 + bits(2);
+			}
+			else if (s == 17)
+				repeat = 3 + bits(3);
+			else
+				repeat = 11 + bits(7);
+			if (i + repeat > lengthCount + distanceCount) {
+				failed = true;
+				return;
+			}
+			while (repeat--)
+				lengths[i++] = value;
+		}
+		build(lengthCode, lengths, lengthCount);
+		build(distanceCode, lengths + lengthCount, distanceCount);
+		codes(out, lengthCode, distanceCode);
+	}
+};
+
+inline void pngPut32(std::vector<unsigned char>& out, unsigned int value) {
+	out.push_back(static_cast<unsigned char>(value >> 24));
+	out.push_back(static_cast<unsigned char>(value >> 16));
+	out.push_back(static_cast<unsigned char>(value >> 8));
+	out.push_back(static_cast<unsigned char>(value));
+}
+inline unsigned int pngGet32(const unsigned char* p) {
+	return (static_cast<unsigned int>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+inline void pngChunk(std::ofstream& file, const char* type, const std::vector<unsigned char>& data) {
+	std::vector<unsigned char> header;
+	pngPut32(header, static_cast<unsigned int>(data.size()));
+	header.insert(header.end(), type, type + 4);
+	unsigned int crc = pngCrc(&header[4], 4);
+	crc = pngCrc(data.data(), data.size(), crc);
+	std::vector<unsigned char> trailer;
+	pngPut32(trailer, crc);
+	file.write(reinterpret_cast<const char*>(header.data()), header.size());
+	file.write(reinterpret_cast<const char*>(data.data()), data.size());
+	file.write(reinterpret_cast<const char*>(trailer.data()), trailer.size());
+}
+
+inline bool writePNG(const std::string& path, const std::vector<unsigned char>& rgba, int width, int height) {
+	std::ofstream file(path.c_str(), std::ios::binary);
+	if (!file) {
+		std::cout << "ERROR::IMAGE::FILE_NOT_WRITTEN: " << path << std::endl;
+		return false;
+	}
+	static const unsigned char signature[8] = { 137, 'P', 'N', 'G', 13, 10, 26, 10 };
+	file.write(reinterpret_cast<const char*>(signature), 8);
+
+	std::vector<unsigned char> header;
+	pngPut32(header, width);
+	pngPut32(header, height);
+	header.push_back(8);	// bit depth
+	header.push_back(6);	// RGBA
+	header.push_back(0);
+	header.push_back(0);
+	header.push_back(0);	// not interlaced
+	pngChunk(file, "IHDR", header);
+
+	// Sub filter: each byte minus the same channel of the pixel to its left, which turns
+	// flat and smoothly lit areas into long runs for the matcher
+	size_t stride = static_cast<size_t>(width) * 4;
+	std::vector<unsigned char> filtered;
+	filtered.reserve((stride + 1) * height);
+	for (int y = height - 1; y >= 0; y--) {
+		const unsigned char* row = &rgba[y * stride];
+		filtered.push_back(1);
+		for (size_t i = 0; i < stride; i++)
+			filtered.push_back(static_cast<unsigned char>(row[i] - (i >= 4 ? row[i - 4] : 0)));
+	}
+
+	DeflateWriter deflate;
+	deflate.bytes.push_back(0x78);	// zlib header: deflate, 32K window
+	deflate.bytes.push_back(0x01);
+	deflate.compress(filtered);
+	unsigned int a = 1, b = 0;	// Adler-32 of the uncompressed data
+	for (size_t i = 0; i < filtered.size(); i++) {
+		a = (a + filtered[i]) % 65521;
+		b = (b + a) % 65521;
+	}
+	pngPut32(deflate.bytes, (b << 16) | a);
+	pngChunk(file, "IDAT", deflate.bytes);
+	pngChunk(file, "IEND", std::vector<unsigned char>());
+	return true;
+}
+
+inline bool readPNG(const std::string& path, std::vector<unsigned char>& rgba, int& width, int& height) {
+	std::ifstream file(path.c_str(), std::ios::binary);
+	if (!file)
+		return false;
+	std::vector<unsigned char> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+	static const unsigned char signature[8] = { 137, 'P', 'N', 'G', 13, 10, 26, 10 };
+	if (data.size() < 8 || !std::equal(signature, signature + 8, data.begin())) {
+		std::cout << "ERROR::IMAGE::NOT_A_PNG: " << path << std::endl;
+		return false;
+	}
+
+	int depth = 0, colorType = -1, interlace = 0;
+	std::vector<unsigned char> compressed;
+	size_t pos = 8;
+	while (pos + 8 <= data.size()) {
+		size_t length = pngGet32(&data[pos]);
+		std::string type(reinterpret_cast<const char*>(&data[pos + 4]), 4);
+		const unsigned char* body = &data[pos + 8];
+		if (pos + 12 + length > data.size())
+			break;
+		if (type == "IHDR" && length >= 13) {
+			width = static_cast<int>(pngGet32(body));
+			height = static_cast<int>(pngGet32(body + 4));
+			depth = body[8];
+			colorType = body[9];
+			interlace = body[12];
+		}
+		else if (type == "IDAT")
+			compressed.insert(compressed.end(), body, body + length);
+		else if (type == "IEND")
+			break;
+		pos += 12 + length;
+	}
+	int channels = colorType == 0 ? 1 : colorType == 2 ? 3 : colorType == 4 ? 2 : colorType == 6 ? 4 : 0;
+	if (depth != 8 || channels == 0 || interlace != 0 || width <= 0 || height <= 0 || compressed.size() < 2) {
+		std::cout << "ERROR::IMAGE::UNSUPPORTED_PNG: " << path << " (8-bit, non-interlaced grey/RGB/RGBA only)" << std::endl;
+		return false;
+	}
+
+	std::vector<unsigned char> raw;
+	size_t stride = static_cast<size_t>(width) * channels;
+	raw.reserve((stride + 1) * height);
+	Inflater inflater(&compressed[2], compressed.size() - 2);	// past the zlib header
+	if (!inflater.run(raw) || raw.size() < (stride + 1) * height) {
+		std::cout << "ERROR::IMAGE::CORRUPT_PNG: " << path << std::endl;
+		return false;
+	}
+
+	// undo the per-row filters in place, then expand to RGBA with the rows flipped
+	rgba.resize(static_cast<size_t>(width) * height * 4);
+	for (int y = 0; y < height; y++) {
+		unsigned char* row = &raw[y * (stride + 1) + 1];
+		const unsigned char* above = y > 0 ? &raw[(y - 1) * (stride + 1) + 1] : NULL;
+		int filter = row[-1];
+		for (size_t i = 0; i < stride; i++) {
+			int left = i >= static_cast<size_t>(channels) ? row[i - channels] : 0;
+			int up = above ? above[i] : 0;
+			int upLeft = above && i >= static_cast<size_t>(channels) ? above[i - channels] : 0;
+			int predicted = 0;
+			if (filter == 1)
+				predicted = left;
+			else if (filter == 2)
+				predicted = up;
+			else if (filter == 3)
+				predicted = (left + up) / 2;
+			else if (filter == 4) {
+				int p = left + up - upLeft;
+				int pa = std::abs(p - left), pb = std::abs(p - up), pc = std::abs(p - upLeft);
+				predicted = pa <= pb && pa <= pc ? left : pb <= pc ? up : upLeft;
+			}
+			row[i] = static_cast<unsigned char>(row[i] + predicted);
+		}
+		unsigned char* dst = &rgba[static_cast<size_t>(height - 1 - y) * width * 4];
+		for (int x = 0; x < width; x++) {
+			const unsigned char* src = &row[x * channels];
+			dst[x * 4] = src[0];
+			dst[x * 4 + 1] = channels >= 3 ? src[1] : src[0];
+			dst[x * 4 + 2] = channels >= 3 ? src[2] : src[0];
+			dst[x * 4 + 3] = channels == 4 ? src[3] : channels == 2 ? src[1] : 255;
+		}
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,200 @@
+#pragma once
+#ifndef regression_h
+#define regression_h
+
+#include "render_backend.h"
+#include "render_queue.h"
+#include "lighting.h"
+#include "camera.h"
+#include "viewport.h"
+#include "png.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMAGE_DIFF_SSE 1
+#include <emmintrin.h>
+#endif
+
+// How far two RGBA8 images are apart; alpha is ignored
+struct ImageDiff {
+	long long differentPixels;	// pixels with any colour channel off by more than the tolerance
+	int maxError;				// largest channel difference
+	double meanError;			// average channel difference
+};
+
+// Compares 'pixels' RGBA8 pixels of 'a' and 'b', 16 bytes (four pixels) per SSE step.
+// 'mask', when given, receives the differences amplified eightfold, for looking at.
+inline ImageDiff diffImages(const unsigned char* a, const unsigned char* b, size_t pixels, int tolerance, unsigned char* mask) {
+	ImageDiff diff = { 0, 0, 0.0 };
+	unsigned long long sum = 0;
+	size_t p = 0;
+#ifdef IMAGE_DIFF_SSE
+	const __m128i rgb = _mm_set1_epi32(0x00ffffff);
+	const __m128i alpha = _mm_set1_epi32(static_cast<int>(0xff000000u));
+	const __m128i limit = _mm_set1_epi8(static_cast<char>(tolerance));
+	const __m128i zero = _mm_setzero_si128();
+	__m128i largest = zero, total = zero;
+	for (; p + 4 <= pixels; p += 4) {
+		__m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + p * 4));
+		__m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + p * 4));
+		// |a - b| per byte from two saturating subtractions
+		__m128i d = _mm_and_si128(_mm_or_si128(_mm_subs_epu8(va, vb), _mm_subs_epu8(vb, va)), rgb);
+		largest = _mm_max_epu8(largest, d);
+		total = _mm_add_epi64(total, _mm_sad_epu8(d, zero));
+		// a pixel is within tolerance when no channel is left after subtracting it
+		__m128i within = _mm_cmpeq_epi32(_mm_subs_epu8(d, limit), zero);
+		int bits = _mm_movemask_ps(_mm_castsi128_ps(within));
+		diff.differentPixels += 4 - ((bits & 1) + ((bits >> 1) & 1) + ((bits >> 2) & 1) + ((bits >> 3) & 1));
+		if (mask) {
+			__m128i shown = _mm_adds_epu8(d, d);
+			shown = _mm_adds_epu8(shown, shown);
+			shown = _mm_adds_epu8(shown, shown);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(mask + p * 4), _mm_or_si128(shown, alpha));
+		}
+	}
+	unsigned char lanes[16];
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(lanes), largest);
+	for (int i = 0; i < 16; i++)
+		diff.maxError = std::max(diff.maxError, static_cast<int>(lanes[i]));
+	unsigned long long halves[2];
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(halves), total);
+	sum = halves[0] + halves[1];
+#endif
+	for (; p < pixels; p++) {
+		int worst = 0;
+		for (int c = 0; c < 3; c++) {
+			int d = std::abs(a[p * 4 + c] - b[p * 4 + c]);
+			worst = std::max(worst, d);
+			sum += d;
+			if (mask)
+				mask[p * 4 + c] = static_cast<unsigned char>(std::min(255, d * 8));
+		}
+		if (mask)
+			mask[p * 4 + 3] = 255;
+		diff.maxError = std::max(diff.maxError, worst);
+		if (worst > tolerance)
+			diff.differentPixels++;
+	}
+	diff.meanError = pixels ? static_cast<double>(sum) / (pixels * 3.0) : 0.0;
+	return diff;
+}
+
+// A fixed camera pose the restaurant is checked from
+struct RegressionTest {
+	std::string name;
+	glm::vec3 position;
+	float yaw, pitch;
+	float time;		// animation clock, for the rotating parts
+};
+
+// Golden-image regression: renders every pose offscreen at a fixed size and compares the
+// frame with golden/<backend>_<test>.png, so a change to the transforms or the vertex
+// data that moves the furniture is caught. Frames are read back asynchronously and the
+// next pose is drawn while the previous one is diffed. Each test reports its render time
+// next to its diff time and result; failed ones leave <test>.actual.png and <test>.diff.png.
+// Only the software rasteriser's goldens are committed: GL frames differ between drivers,
+// so a machine records its own opengl_*.png once with --update-golden before --regress.
+class RegressionSuite {
+
+public:
+	bool active;				// --regress
+	bool update;				// --update-golden: store the frames as the new goldens
+	std::string directory;
+	int width, height;
+	int tolerance;				// per colour channel, out of 255
+	double allowedDifference;	// share of pixels that may exceed it (edge rasterisation differs between drivers)
+	std::vector<RegressionTest> tests;
+
+	RegressionSuite() : active(false), update(false), directory("golden"), width(800), height(600), tolerance(8), allowedDifference(0.001) {
+	}
+
+	void add(const char* name, glm::vec3 position, float yaw, float pitch, float time = 0.0f) {
+		RegressionTest test = { name, position, yaw, pitch, time };
+		tests.push_back(test);
+	}
+
+	// returns the number of failed tests
+	int run(RenderBackend& backend, RenderQueue& scene, Lighting& lighting) {
+		if (update) {
+#ifdef _WIN32
+			_mkdir(directory.c_str());
+#else
+			mkdir(directory.c_str(), 0755);
+#endif
+		}
+		printf("regression (%s, %dx%d, tolerance %d, %.2f%% of pixels):\n", backend.name(), width, height, tolerance, allowedDifference * 100.0);
+		printf("%-12s %10s %10s %10s %6s  %s\n", "test", "render ms", "diff ms", "differing", "max", "result");
+		int failures = 0;
+		Viewport viewport(width, height);
+		// one frame in flight: pose t renders while pose t - 1 comes back and is compared
+		for (size_t t = 0; t <= tests.size(); t++) {
+			if (t < tests.size()) {
+				const RegressionTest& test = tests[t];
+				Camera camera(test.position, glm::vec3(0.0f, 1.0f, 0.0f), test.yaw, test.pitch);
+				FrameParams frame(viewport);
+				frame.view = camera.GetViewMatrix();
+				frame.projection = viewport.projection(camera.Zoom);
+				frame.eye = camera.Position;
+				frame.time = test.time;
+				backend.render(scene, lighting, frame);
+				backend.requestPixels();
+			}
+			if (t > 0) {
+				FrameImage image;
+				backend.readPixels(image, true);
+				if (!check(backend, tests[t - 1], image))
+					failures++;
+			}
+		}
+		printf("%d of %d passed\n", static_cast<int>(tests.size()) - failures, static_cast<int>(tests.size()));
+		return failures;
+	}
+
+private:
+	bool check(const RenderBackend& backend, const RegressionTest& test, const FrameImage& image) {
+		std::string path = directory + "/" + backend.name() + "_" + test.name;
+		if (update) {
+			bool written = writePNG(path + ".png", image.rgba, image.width, image.height);
+			printf("%-12s %10.2f %10s %10s %6s  %s\n", test.name.c_str(), image.renderMilliseconds, "-", "-", "-", written ? "updated" : "NOT WRITTEN");
+			return written;
+		}
+
+		std::vector<unsigned char> golden;
+		int goldenWidth = 0, goldenHeight = 0;
+		if (!readPNG(path + ".png", golden, goldenWidth, goldenHeight)) {
+			printf("%-12s %10.2f %10s %10s %6s  FAIL (no golden %s.png, run with --update-golden)\n", test.name.c_str(), image.renderMilliseconds, "-", "-", "-", path.c_str());
+			return false;
+		}
+		if (goldenWidth != image.width || goldenHeight != image.height) {
+			printf("%-12s %10.2f %10s %10s %6s  FAIL (golden is %dx%d)\n", test.name.c_str(), image.renderMilliseconds, "-", "-", "-", goldenWidth, goldenHeight);
+			return false;
+		}
+
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		size_t pixels = static_cast<size_t>(image.width) * image.height;
+		ImageDiff diff = diffImages(image.rgba.data(), golden.data(), pixels, tolerance, NULL);
+		double diffMilliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		double share = static_cast<double>(diff.differentPixels) / pixels;
+		bool passed = share <= allowedDifference;
+		printf("%-12s %10.2f %10.2f %9.3f%% %6d  %s\n", test.name.c_str(), image.renderMilliseconds, diffMilliseconds, share * 100.0, diff.maxError, passed ? "ok" : "FAIL");
+		if (!passed) {
+			std::vector<unsigned char> mask(image.rgba.size());
+			diffImages(image.rgba.data(), golden.data(), pixels, tolerance, mask.data());
+			writePNG(path + ".actual.png", image.rgba, image.width, image.height);
+			writePNG(path + ".diff.png", mask, image.width, image.height);
+		}
+		return passed;
+	}
+};
+
+#endif
@@ -0,0 +1,76 @@
+#pragma once
+#ifndef render_backend_h
+#define render_backend_h
+
+#include "lighting.h"
+#include "render_queue.h"
+#include "viewport.h"
+#include <glm/glm.hpp>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// Everything a backend needs to draw one frame besides the scene and its lights
+struct FrameParams {
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::vec3 eye;
+	float time;			// animation clock in seconds (spins the rotating parts)
+	Viewport viewport;
+
+	FrameParams(const Viewport& viewport) : view(1.0f), projection(1.0f), eye(0.0f), time(0.0f), viewport(viewport) {
+	}
+};
+
+// A rendered frame read back to the CPU: tightly packed RGBA8 rows, bottom row first
+// (glReadPixels order), and how long the backend took to draw it
+struct FrameImage {
+	std::vector<unsigned char> rgba;
+	int width, height;
+	double renderMilliseconds;
+
+	FrameImage() : width(0), height(0), renderMilliseconds(0.0) {
+	}
+};
+
+// A way of turning the recorded scene into pixels: the OpenGL renderer, or the software
+// rasteriser for machines without a GPU. Both consume the same meshes, transforms and
+// lights, so their frames can be compared.
+class RenderBackend {
+
+public:
+	virtual ~RenderBackend() {
+	}
+	virtual const char* name() const = 0;
+	// draws one frame; the result stays in the backend's framebuffer
+	virtual void render(RenderQueue& scene, Lighting& lighting, const FrameParams& frame) = 0;
+	// starts copying the frame just rendered back to the CPU without waiting for it
+	virtual void requestPixels() = 0;
+	// the oldest requested frame, in request order; without 'wait' only if it has already
+	// arrived. Returns false when there is nothing (yet) to return.
+	virtual bool readPixels(FrameImage& image, bool wait) = 0;
+};
+
+// binary PPM, the simplest format any image viewer opens; rows are flipped to top-first
+inline bool writePPM(const std::string& path, const std::vector<unsigned char>& rgba, int width, int height) {
+	std::ofstream file(path.c_str(), std::ios::binary);
+	if (!file) {
+		std::cout << "ERROR::IMAGE::FILE_NOT_WRITTEN: " << path << std::endl;
+		return false;
+	}
+	file << "P6\n" << width << " " << height << "\n255\n";
+	std::vector<unsigned char> row(width * 3);
+	for (int y = height - 1; y >= 0; y--) {
+		const unsigned char* src = &rgba[static_cast<size_t>(y) * width * 4];
+		for (int x = 0; x < width; x++) {
+			row[x * 3] = src[x * 4];
+			row[x * 3 + 1] = src[x * 4 + 1];
+			row[x * 3 + 2] = src[x * 4 + 2];
+		}
+		file.write(reinterpret_cast<const char*>(row.data()), row.size());
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,246 @@
+#pragma once
+#ifndef render_queue_h
+#define render_queue_h
+
+#include "shader.h"
+#include "mesh.h"
+#include "rotating_part.h"
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <tuple>
+#include <vector>
+
+// which draws a pass wants: static geometry, moving parts, or both
+enum Draw_Kind {
+	DRAW_STATIC = 1,
+	DRAW_DYNAMIC = 2,
+	DRAW_ALL = DRAW_STATIC | DRAW_DYNAMIC
+};
+
+// edge of the world-space cells static geometry is merged in (RenderQueue::mergeStatic)
+const float MERGE_CHUNK_SIZE = 8.0f;
+
+// what part of the restaurant a draw belongs to, for per-part GPU timing
+enum Draw_Category {
+	CATEGORY_ROOM,		// floor, walls, ceiling, rack, bar, window
+	CATEGORY_TABLES,	// tables with their chairs
+	CATEGORY_TOOLS,
+	CATEGORY_GLASSES,
+	CATEGORY_FAN,
+	CATEGORY_GRID,		// the lines on the floor and walls
+	DRAW_CATEGORIES
+};
+const char* const DRAW_CATEGORY_NAMES[DRAW_CATEGORIES] = { "room shell", "tables", "tools", "glasses", "fan", "grid" };
+
+// What the replays since RenderQueue::resetStats() submitted (every pass counts)
+struct RenderStats {
+	int drawCalls;
+	long long triangles;	// submitted; occlusion-culled draws are still counted
+	int stateChanges;		// mesh, material or spin switches between consecutive draws
+};
+
+// One mesh instance: its model matrix and, for moving parts, the mechanism that spins it
+struct DrawItem {
+	const Mesh* mesh;
+	glm::mat4 model;
+	const RotatingPart* spin;	// NULL for static geometry
+	glm::vec3 boundsMin, boundsMax;	// world space, at rest
+	int group;				// index into RenderQueue::groups, -1 when ungrouped
+	int category;			// Draw_Category
+
+	int kind() const {
+		return spin ? DRAW_DYNAMIC : DRAW_STATIC;
+	}
+};
+
+// A piece of furniture (a table with its chairs, a tool, a glass) whose draws can be
+// skipped together. 'query' is an occlusion query on the group's bounds, issued by
+// OcclusionCuller; while 'tested' is set, the group's draws are conditional on it.
+struct DrawGroup {
+	glm::vec3 boundsMin, boundsMax;
+	unsigned int query;
+	bool tested;
+};
+
+// The scene as a list of draws, recorded once at startup by main and the furniture
+// classes' submit() and replayed by every pass (shadows, the main view, ...).
+// Nothing in the restaurant moves on the CPU, so the list never has to be rebuilt;
+// only the order it is replayed in changes (front to back from the camera).
+class RenderQueue {
+
+public:
+	std::vector<DrawItem> items;
+	std::vector<int> order;		// replay order, indices into items
+	std::vector<DrawGroup> groups;
+	int category;				// Draw_Category of the draws added next
+	mutable RenderStats stats;	// for the HUD
+	std::deque<Mesh> merged;	// built by mergeStatic(); main uploads and deletes them
+
+	RenderQueue() : category(CATEGORY_ROOM), currentGroup(-1) {
+		resetStats();
+	}
+
+	void resetStats() {
+		RenderStats zero = { 0, 0, 0 };
+		stats = zero;
+	}
+
+	// draws added between beginGroup() and endGroup() form one occlusion-culled group
+	int beginGroup() {
+		DrawGroup group = { glm::vec3(1e30f), glm::vec3(-1e30f), 0, false };
+		groups.push_back(group);
+		currentGroup = static_cast<int>(groups.size()) - 1;
+		return currentGroup;
+	}
+	void endGroup() {
+		currentGroup = -1;
+	}
+
+	void add(const Mesh& mesh, const glm::mat4& model, const RotatingPart* spin = NULL) {
+		DrawItem item = { &mesh, model, spin, glm::vec3(1e30f), glm::vec3(-1e30f), currentGroup, category };
+		for (int corner = 0; corner < 8; corner++) {
+			glm::vec3 local(corner & 1 ? mesh.boundsMax.x : mesh.boundsMin.x,
+				corner & 2 ? mesh.boundsMax.y : mesh.boundsMin.y,
+				corner & 4 ? mesh.boundsMax.z : mesh.boundsMin.z);
+			glm::vec3 world = glm::vec3(model * glm::vec4(local, 1.0f));
+			item.boundsMin = glm::min(item.boundsMin, world);
+			item.boundsMax = glm::max(item.boundsMax, world);
+		}
+		if (currentGroup >= 0) {
+			groups[currentGroup].boundsMin = glm::min(groups[currentGroup].boundsMin, item.boundsMin);
+			groups[currentGroup].boundsMax = glm::max(groups[currentGroup].boundsMax, item.boundsMax);
+		}
+		order.push_back(static_cast<int>(items.size()));
+		items.push_back(item);
+	}
+
+	// Load-time bake: the static draws outside any group (the room shell, the grid, the
+	// fan's housing) are pre-transformed into world-space meshes, one per category,
+	// material and MERGE_CHUNK_SIZE cell of the draw's centre, and replayed as one draw
+	// each with an identity model. Every merged chunk becomes an occlusion group with
+	// its own bounds, so sorting and culling still work per chunk. Returns the draws saved.
+	int mergeStatic() {
+		typedef std::tuple<int, float, float, float, float, int, int, int> ChunkKey;
+		std::map<ChunkKey, size_t> chunks;	// key -> index into baked
+		std::vector<DrawItem> kept, baked;	// baked[c] draws merged[first + c]
+		size_t first = merged.size();
+		for (size_t i = 0; i < items.size(); i++) {
+			const DrawItem& item = items[i];
+			if (item.spin || item.group >= 0) {
+				kept.push_back(item);
+				continue;
+			}
+			const Material& m = item.mesh->material;
+			glm::vec3 cell = glm::floor((item.boundsMin + item.boundsMax) * 0.5f / MERGE_CHUNK_SIZE);
+			ChunkKey key(item.category, m.ambient, m.diffuse, m.specular, m.shininess,
+				static_cast<int>(cell.x), static_cast<int>(cell.y), static_cast<int>(cell.z));
+			std::map<ChunkKey, size_t>::iterator found = chunks.find(key);
+			if (found == chunks.end()) {
+				merged.push_back(Mesh());
+				Mesh& mesh = merged.back();
+				mesh.VAO = mesh.VBO = mesh.EBO = 0;
+				mesh.indexCount = 0;
+				mesh.material = m;
+				DrawItem chunk = { &mesh, glm::mat4(1.0f), NULL, glm::vec3(0.0f), glm::vec3(0.0f), -1, item.category };
+				found = chunks.insert(std::make_pair(key, baked.size())).first;
+				baked.push_back(chunk);
+			}
+			appendMesh(merged[first + found->second], *item.mesh, item.model);
+		}
+		if (baked.empty())
+			return 0;
+
+		int saved = static_cast<int>(items.size() - kept.size() - baked.size());
+		size_t vertices = 0;
+		items.swap(kept);
+		for (size_t c = 0; c < baked.size(); c++) {
+			DrawItem& chunk = baked[c];
+			chunk.boundsMin = chunk.mesh->boundsMin;
+			chunk.boundsMax = chunk.mesh->boundsMax;
+			DrawGroup group = { chunk.boundsMin, chunk.boundsMax, 0, false };
+			chunk.group = static_cast<int>(groups.size());
+			groups.push_back(group);
+			items.push_back(chunk);
+			vertices += chunk.mesh->vertices.size() / MESH_STRIDE;
+		}
+		order.resize(items.size());
+		for (size_t i = 0; i < order.size(); i++)
+			order[i] = static_cast<int>(i);
+		printf("static merge: %d draws baked into %d chunks (%d vertices), %d draws left\n",
+			saved + static_cast<int>(baked.size()), static_cast<int>(baked.size()), static_cast<int>(vertices), static_cast<int>(items.size()));
+		return saved;
+	}
+
+	// nearest first, by distance from the eye to each item's bounds, so that early depth
+	// testing rejects the fragments of whatever is hidden behind them
+	void sortFrontToBack(const glm::vec3& eye) {
+		distances.resize(items.size());
+		for (size_t i = 0; i < items.size(); i++) {
+			glm::vec3 nearest = glm::clamp(eye, items[i].boundsMin, items[i].boundsMax);
+			glm::vec3 d = nearest - eye;
+			distances[i] = glm::dot(d, d);
+		}
+		std::sort(order.begin(), order.end(), [this](int a, int b) { return distances[a] < distances[b]; });
+	}
+
+	// lit draw: model, normal matrix and material per item; with 'occlusion', grouped
+	// draws are skipped on the GPU when their group's last occlusion query saw nothing.
+	// 'category' limits the replay to one Draw_Category (-1: all).
+	void draw(const Shader& shader, int kinds = DRAW_ALL, bool occlusion = false, int category = -1) const {
+		replay(shader, kinds, false, occlusion, category);
+	}
+	// depth-only draw: the shader only needs the model matrix (and the spin uniforms)
+	void drawDepth(const Shader& shader, int kinds = DRAW_ALL, bool occlusion = false, int category = -1) const {
+		replay(shader, kinds, true, occlusion, category);
+	}
+
+private:
+	std::vector<float> distances;	// scratch for sortFrontToBack
+	int currentGroup;
+
+	void replay(const Shader& shader, int kinds, bool depthOnly, bool occlusion, int category) const {
+		const RotatingPart* current = NULL;
+		const Mesh* lastMesh = NULL;
+		RotatingPart::clear(shader);
+		for (size_t i = 0; i < order.size(); i++) {
+			const DrawItem& item = items[order[i]];
+			if (!(item.kind() & kinds) || (category >= 0 && item.category != category))
+				continue;
+			if (item.spin != current) {
+				if (item.spin)
+					item.spin->apply(shader);
+				else
+					RotatingPart::clear(shader);
+				current = item.spin;
+				stats.stateChanges++;
+			}
+			if (item.mesh != lastMesh) {
+				// a new vertex array, and for lit draws usually a new material
+				stats.stateChanges++;
+				lastMesh = item.mesh;
+			}
+			const DrawGroup* group = item.group >= 0 ? &groups[item.group] : NULL;
+			bool conditional = occlusion && group && group->tested;
+			// no wait: if last frame's result has not arrived the draw simply happens
+			if (conditional)
+				glBeginConditionalRender(group->query, GL_QUERY_NO_WAIT);
+			if (depthOnly)
+				drawMeshDepth(shader, *item.mesh, item.model);
+			else
+				drawMesh(shader, *item.mesh, item.model);
+			if (conditional)
+				glEndConditionalRender();
+			stats.drawCalls++;
+			stats.triangles += item.mesh->indexCount / 3;
+		}
+		if (current)
+			RotatingPart::clear(shader);
+	}
+};
+
+#endif
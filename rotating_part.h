@@ -0,0 +1,62 @@
+#pragma once
+#ifndef rotating_part_h
+#define rotating_part_h
+
+#include "shader.h"
+#include <glm/glm.hpp>
+#include <cmath>
+
+// A mechanism that spins about a fixed pivot and axis (fan blades and the like).
+// Its model matrices never change; the rotation is evaluated in the vertex shader
+// from the "time" uniform, so a running part costs nothing on the CPU per frame.
+class RotatingPart {
+
+public:
+	glm::vec3 pivot;
+	glm::vec3 axis;
+	float speed;	// degrees per second while running
+	double phase;	// angle in degrees at time 0, in [0, 360) (the frozen angle while stopped)
+	bool running;
+
+	RotatingPart(glm::vec3 pivot = glm::vec3(0.0f), glm::vec3 axis = glm::vec3(0.0f, 1.0f, 0.0f), float speed = 0.0f)
+		: pivot(pivot), axis(glm::normalize(axis)), speed(speed), phase(0.0f), running(false) {
+	}
+
+	float angleAt(double time) const {
+		return static_cast<float>(running ? wrap(phase + speed * time) : phase);
+	}
+	// start/stop keep the current angle so toggling never makes the part jump; the phase
+	// is rebased in double and wrapped, so hours of clock time do not eat its precision
+	void start(double time) {
+		if (!running) {
+			phase = wrap(phase - speed * time);
+			running = true;
+		}
+	}
+	void stop(double time) {
+		if (running) {
+			phase = wrap(phase + speed * time);
+			running = false;
+		}
+	}
+
+	void apply(const Shader& shader) const {
+		shader.setVec3("spinPivot", pivot);
+		shader.setVec3("spinAxis", axis);
+		shader.setFloat("spinSpeed", running ? speed : 0.0f);
+		shader.setFloat("spinPhase", static_cast<float>(phase));
+	}
+	// static geometry drawn after a rotating part must not inherit its spin
+	static void clear(const Shader& shader) {
+		shader.setFloat("spinSpeed", 0.0f);
+		shader.setFloat("spinPhase", 0.0f);
+	}
+
+private:
+	static double wrap(double degrees) {
+		double wrapped = std::fmod(degrees, 360.0);
+		return wrapped < 0.0 ? wrapped + 360.0 : wrapped;
+	}
+};
+
+#endif
@@ -11,6 +11,10 @@
 #include <glad/glad.h>
 #include <glm/glm.hpp>
 
+#include "shader_cache.h"
+#include "trace.h"
+
+#include <chrono>
 #include <string>
 #include <fstream>
 #include <sstream>
@@ -20,9 +24,13 @@ class Shader
 {
 public:
     unsigned int ID;
-    // constructor generates the shader on the fly
+    // an empty shader (ID 0) for compile() to fill in later
+    Shader() : ID(0)
+    {
+    }
+    // constructor generates the shader on the fly, or loads the program from 'cache' when given
     // ------------------------------------------------------------------------
-    Shader(const char* vertexPath, const char* fragmentPath)
+    Shader(const char* vertexPath, const char* fragmentPath, ShaderCache* cache = NULL)
     {
         // 1. retrieve the vertex/fragment source code from filePath
         std::string vertexCode;
@@ -52,6 +60,17 @@ public:
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
         }
+        compile(vertexCode, fragmentCode, cache);
+    }
+    // builds the program from source text (files with #defines added, see shader_variants.h)
+    // ------------------------------------------------------------------------
+    void compile(const std::string& vertexCode, const std::string& fragmentCode, ShaderCache* cache = NULL)
+    {
+        TRACE_SCOPE("compile shader");
+        // a program linked from the same sources by an earlier run needs no compiling
+        if (cache && cache->load(vertexCode, fragmentCode, ID))
+            return;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
         const char* vShaderCode = vertexCode.c_str();
         const char* fShaderCode = fragmentCode.c_str();
         // 2. compile shaders
@@ -70,12 +89,15 @@ public:
         ID = glCreateProgram();
         glAttachShader(ID, vertex);
         glAttachShader(ID, fragment);
+        if (cache)
+            cache->prepare(ID);
         glLinkProgram(ID);
         checkCompileErrors(ID, "PROGRAM");
         // delete the shaders as they're linked into our program now and no longer necessary
         glDeleteShader(vertex);
         glDeleteShader(fragment);
-
+        if (cache)
+            cache->store(vertexCode, fragmentCode, ID, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
     }
     // activate the shader
     // ------------------------------------------------------------------------
@@ -0,0 +1,177 @@
+#pragma once
+#ifndef shader_cache_h
+#define shader_cache_h
+
+#include "trace.h"
+#include <glad/glad.h>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/stat.h>
+#endif
+
+// program binaries are GL 4.1 / ARB_get_program_binary; the context is 3.3 core, so the
+// entry points are looked up when the cache starts rather than taken from glad
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+const unsigned int SHADER_CACHE_MAGIC = 0x48435350;	// "PSCH"
+const unsigned int SHADER_CACHE_VERSION = 1;
+
+// 64-bit FNV-1a
+inline unsigned long long hashBytes(const std::string& bytes, unsigned long long hash = 14695981039346656037ull) {
+	for (size_t i = 0; i < bytes.size(); i++) {
+		hash ^= static_cast<unsigned char>(bytes[i]);
+		hash *= 1099511628211ull;
+	}
+	return hash;
+}
+
+// Keeps linked shader programs on disk (glGetProgramBinary) so later launches skip
+// compiling and linking. A program is filed under the hash of its sources; the file also
+// holds the driver string (vendor, renderer, version), and a binary from another driver,
+// or one the driver refuses, is compiled from source again and overwrites the entry.
+// Compile and load times are added up for the startup report.
+class ShaderCache {
+
+public:
+	bool enabled;				// --no-shader-cache compiles everything from source
+	std::string directory;
+	int hits, misses;
+	double hitMilliseconds;		// spent loading binaries
+	double compileMilliseconds;	// spent compiling and linking from source
+
+	ShaderCache() : enabled(true), directory("shader_cache"), hits(0), misses(0), hitMilliseconds(0.0), compileMilliseconds(0.0),
+		getProgramBinary(NULL), programBinary(NULL), programParameteri(NULL) {
+	}
+
+	// needs a current context; turns the cache off when the driver offers no binary formats
+	void init(GLADloadproc load) {
+		if (!enabled)
+			return;
+		GLint formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		glGetError();	// GL_INVALID_ENUM where the query itself is unknown
+		getProgramBinary = reinterpret_cast<GetProgramBinaryProc>(load("glGetProgramBinary"));
+		programBinary = reinterpret_cast<ProgramBinaryProc>(load("glProgramBinary"));
+		programParameteri = reinterpret_cast<ProgramParameteriProc>(load("glProgramParameteri"));
+		if (formats <= 0 || !getProgramBinary || !programBinary || !programParameteri) {
+			std::cout << "SHADER_CACHE::UNSUPPORTED: the driver has no program binary formats, compiling from source" << std::endl;
+			enabled = false;
+			return;
+		}
+		driver = std::string(reinterpret_cast<const char*>(glGetString(GL_VENDOR))) + "|" +
+			reinterpret_cast<const char*>(glGetString(GL_RENDERER)) + "|" + reinterpret_cast<const char*>(glGetString(GL_VERSION));
+#ifdef _WIN32
+		_mkdir(directory.c_str());
+#else
+		mkdir(directory.c_str(), 0755);
+#endif
+	}
+
+	// a program linked from these sources by an earlier run on this driver; false to compile
+	bool load(const std::string& vertexCode, const std::string& fragmentCode, unsigned int& program) {
+		if (!enabled)
+			return false;
+		TRACE_SCOPE("load program binary");
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		std::ifstream in(path(vertexCode, fragmentCode).c_str(), std::ios::binary);
+		unsigned int header[4] = { 0 };		// magic, version, binary format, binary length
+		unsigned int driverLength = 0;
+		if (!in || !in.read(reinterpret_cast<char*>(header), sizeof(header)) || header[0] != SHADER_CACHE_MAGIC || header[1] != SHADER_CACHE_VERSION ||
+			!in.read(reinterpret_cast<char*>(&driverLength), sizeof(driverLength)) || driverLength != driver.size())
+			return false;
+		std::string fileDriver(driverLength, '\0');
+		if (!in.read(&fileDriver[0], driverLength) || fileDriver != driver)
+			return false;
+		std::vector<char> binary(header[3]);
+		if (binary.empty() || !in.read(binary.data(), binary.size()))
+			return false;
+
+		program = glCreateProgram();
+		programBinary(program, header[2], binary.data(), static_cast<GLsizei>(binary.size()));
+		GLint linked = 0;
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+		if (!linked) {
+			std::cout << "SHADER_CACHE::BINARY_REJECTED: recompiling " << path(vertexCode, fragmentCode) << std::endl;
+			glDeleteProgram(program);
+			program = 0;
+			return false;
+		}
+		hits++;
+		hitMilliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+		return true;
+	}
+
+	// call between glCreateProgram and glLinkProgram, so the driver keeps the binary
+	void prepare(unsigned int program) const {
+		if (enabled)
+			programParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
+
+	// a program was compiled and linked from these sources in 'milliseconds'; files its binary
+	void store(const std::string& vertexCode, const std::string& fragmentCode, unsigned int program, double milliseconds) {
+		misses++;
+		compileMilliseconds += milliseconds;
+		GLint linked = 0, length = 0;
+		glGetProgramiv(program, GL_LINK_STATUS, &linked);
+		if (!enabled || !linked)
+			return;
+		glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0)
+			return;
+		std::vector<char> binary(length);
+		GLenum format = 0;
+		getProgramBinary(program, length, &length, &format, binary.data());
+		std::string file = path(vertexCode, fragmentCode);
+		std::ofstream out(file.c_str(), std::ios::binary);
+		if (!out) {
+			std::cout << "ERROR::SHADER_CACHE::FILE_NOT_WRITTEN: " << file << std::endl;
+			return;
+		}
+		unsigned int header[4] = { SHADER_CACHE_MAGIC, SHADER_CACHE_VERSION, format, static_cast<unsigned int>(length) };
+		unsigned int driverLength = static_cast<unsigned int>(driver.size());
+		out.write(reinterpret_cast<const char*>(header), sizeof(header));
+		out.write(reinterpret_cast<const char*>(&driverLength), sizeof(driverLength));
+		out.write(driver.data(), driver.size());
+		out.write(binary.data(), length);
+	}
+
+	void report() const {
+		printf("shader cache%s: %d programs loaded in %.2f ms, %d compiled in %.2f ms\n", enabled ? "" : " (off)",
+			hits, hitMilliseconds, misses, compileMilliseconds);
+	}
+
+private:
+	typedef void (APIENTRYP GetProgramBinaryProc)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary);
+	typedef void (APIENTRYP ProgramBinaryProc)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length);
+	typedef void (APIENTRYP ProgramParameteriProc)(GLuint program, GLenum pname, GLint value);
+
+	GetProgramBinaryProc getProgramBinary;
+	ProgramBinaryProc programBinary;
+	ProgramParameteriProc programParameteri;
+	std::string driver;
+
+	std::string path(const std::string& vertexCode, const std::string& fragmentCode) const {
+		// the separator keeps "ab"+"c" and "a"+"bc" apart
+		unsigned long long hash = hashBytes(fragmentCode, hashBytes(std::string(1, '\0'), hashBytes(vertexCode)));
+		char name[24];
+		snprintf(name, sizeof(name), "%016llx.bin", hash);
+		return directory + "/" + name;
+	}
+};
+
+#endif
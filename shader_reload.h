@@ -0,0 +1,337 @@
+#pragma once
+#ifndef shader_reload_h
+#define shader_reload_h
+
+#include "shader.h"
+#include "shader_variants.h"
+#include <glad/glad.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+#include <sys/stat.h>
+
+#ifndef GL_MAX_SHADER_COMPILER_THREADS_KHR
+#define GL_MAX_SHADER_COMPILER_THREADS_KHR 0x91B0
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+// without KHR_parallel_shader_compile a program is left alone this many frames before its
+// status is asked for, by which time drivers that compile in the background are done
+const int RELOAD_SETTLE_FRAMES = 3;
+
+// Rebuilds shader programs while the restaurant keeps running. A background thread
+// watches the shader files (inotify on Linux, modification times elsewhere) and reads
+// changed sources; update() starts compiling them on the render thread and, frames
+// later, swaps the finished program into its Shader between two frames. With
+// KHR_parallel_shader_compile the driver compiles on its own threads and is only asked
+// whether it is done. A program that fails to compile or link is reported and dropped,
+// and the old one keeps drawing. The frame loop never waits: not for the watcher (the
+// sources are taken with try_lock) and not for the compiler.
+class ShaderReloader {
+
+public:
+	int reloads;		// programs swapped in
+	int failures;		// edits that did not compile or link
+
+	ShaderReloader() : reloads(0), failures(0), frame(0), parallel(false), stopping(false) {
+	}
+	~ShaderReloader() {
+		stopWatching();
+	}
+
+	// call for every program before start(); 'features' are #defined into the sources
+	void watch(Shader& shader, const std::string& vertexPath, const std::string& fragmentPath, ShaderFeatures features = ShaderFeatures()) {
+		Program program;
+		program.shader = &shader;
+		program.vertexPath = vertexPath;
+		program.fragmentPath = fragmentPath;
+		program.features = features;
+		programs.push_back(program);
+		sources.push_back(Sources());
+	}
+	// every variant; those not built yet read the files when they are
+	void watch(ShaderVariants& variants) {
+		for (unsigned int v = 0; v < SHADER_VARIANT_COUNT; v++)
+			watch(variants.variant(v), variants.vertexPath, variants.fragmentPath, ShaderFeatures(v));
+	}
+
+	// needs a current context (to look for KHR_parallel_shader_compile)
+	void start(GLADloadproc load) {
+		if (watcher.joinable() || programs.empty())
+			return;
+		GLint extensions = 0;
+		glGetIntegerv(GL_NUM_EXTENSIONS, &extensions);
+		for (GLint i = 0; i < extensions && !parallel; i++)
+			parallel = strcmp(reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i)), "GL_KHR_parallel_shader_compile") == 0;
+		typedef void (APIENTRYP MaxShaderCompilerThreadsProc)(GLuint count);
+		MaxShaderCompilerThreadsProc maxCompilerThreads = parallel ? reinterpret_cast<MaxShaderCompilerThreadsProc>(load("glMaxShaderCompilerThreadsKHR")) : NULL;
+		if (maxCompilerThreads)
+			maxCompilerThreads(0xFFFFFFFFu);	// as many as the driver likes
+		stopping = false;
+		watcher = std::thread(&ShaderReloader::watchFiles, this);
+	}
+	// while the context is still current: also drops the builds not swapped in yet
+	void stop() {
+		stopWatching();
+		for (size_t p = 0; p < programs.size(); p++)
+			discard(programs[p].build);
+	}
+
+	// once per frame, before drawing; true when a program was swapped
+	bool update() {
+		frame++;
+		std::unique_lock<std::mutex> lock(mutex, std::try_to_lock);
+		if (lock.owns_lock()) {
+			for (size_t p = 0; p < programs.size(); p++)
+				if (sources[p].changed) {
+					sources[p].changed = false;
+					if (!programs[p].shader->ID)
+						continue;
+					TRACE_SCOPE("start shader rebuild");
+					// a newer edit replaces a build still in progress
+					discard(programs[p].build);
+					compile(programs[p], sources[p].vertexCode, sources[p].fragmentCode);
+				}
+			lock.unlock();
+		}
+
+		bool swapped = false;
+		for (size_t p = 0; p < programs.size(); p++) {
+			Build& build = programs[p].build;
+			if (!build.program || !finished(build))
+				continue;
+			if (linked(programs[p])) {
+				glDeleteProgram(programs[p].shader->ID);
+				programs[p].shader->ID = build.program;
+				build.program = 0;
+				reloads++;
+				swapped = true;
+				printf("shader reload: %s + %s (%.0f ms)\n", programs[p].vertexPath.c_str(), programs[p].fragmentPath.c_str(),
+					std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - build.start).count());
+			}
+			else
+				failures++;
+			discard(build);
+		}
+		return swapped;
+	}
+
+private:
+	// a program being compiled on the render thread
+	struct Build {
+		GLuint vertex, fragment, program;
+		long long frame;	// when compiling started
+		std::chrono::steady_clock::time_point start;
+		Build() : vertex(0), fragment(0), program(0), frame(0) {
+		}
+	};
+	struct Program {
+		Shader* shader;
+		std::string vertexPath, fragmentPath;
+		ShaderFeatures features;
+		Build build;
+	};
+	// handed from the watcher to the render thread, under 'mutex'
+	struct Sources {
+		bool changed;
+		std::string vertexCode, fragmentCode;
+		Sources() : changed(false) {
+		}
+	};
+
+	std::vector<Program> programs;
+	std::vector<Sources> sources;
+	std::mutex mutex;
+	std::thread watcher;
+	long long frame;
+	bool parallel;		// KHR_parallel_shader_compile
+	std::atomic<bool> stopping;
+
+	void stopWatching() {
+		if (watcher.joinable()) {
+			stopping = true;
+			watcher.join();
+		}
+	}
+
+	void compile(Program& program, const std::string& vertexCode, const std::string& fragmentCode) {
+		Build& build = program.build;
+		const char* vShaderCode = vertexCode.c_str();
+		const char* fShaderCode = fragmentCode.c_str();
+		build.vertex = glCreateShader(GL_VERTEX_SHADER);
+		glShaderSource(build.vertex, 1, &vShaderCode, NULL);
+		glCompileShader(build.vertex);
+		build.fragment = glCreateShader(GL_FRAGMENT_SHADER);
+		glShaderSource(build.fragment, 1, &fShaderCode, NULL);
+		glCompileShader(build.fragment);
+		build.program = glCreateProgram();
+		glAttachShader(build.program, build.vertex);
+		glAttachShader(build.program, build.fragment);
+		glLinkProgram(build.program);
+		build.frame = frame;
+		build.start = std::chrono::steady_clock::now();
+	}
+	bool finished(const Build& build) const {
+		if (!parallel)
+			return frame - build.frame >= RELOAD_SETTLE_FRAMES;
+		GLint done = GL_FALSE;
+		glGetProgramiv(build.program, GL_COMPLETION_STATUS_KHR, &done);
+		return done == GL_TRUE;
+	}
+	// reports what went wrong; the running program stays
+	bool linked(const Program& program) const {
+		const Build& build = program.build;
+		GLint success = 0;
+		GLchar infoLog[1024];
+		glGetShaderiv(build.vertex, GL_COMPILE_STATUS, &success);
+		if (!success) {
+			glGetShaderInfoLog(build.vertex, 1024, NULL, infoLog);
+			std::cout << "ERROR::SHADER_RELOAD::COMPILATION_FAILED: " << program.vertexPath << ", keeping the running program\n" << infoLog << std::endl;
+			return false;
+		}
+		glGetShaderiv(build.fragment, GL_COMPILE_STATUS, &success);
+		if (!success) {
+			glGetShaderInfoLog(build.fragment, 1024, NULL, infoLog);
+			std::cout << "ERROR::SHADER_RELOAD::COMPILATION_FAILED: " << program.fragmentPath << ", keeping the running program\n" << infoLog << std::endl;
+			return false;
+		}
+		glGetProgramiv(build.program, GL_LINK_STATUS, &success);
+		if (!success) {
+			glGetProgramInfoLog(build.program, 1024, NULL, infoLog);
+			std::cout << "ERROR::SHADER_RELOAD::LINKING_FAILED: " << program.vertexPath << " + " << program.fragmentPath << ", keeping the running program\n" << infoLog << std::endl;
+			return false;
+		}
+		return true;
+	}
+	static void discard(Build& build) {
+		if (build.vertex)
+			glDeleteShader(build.vertex);
+		if (build.fragment)
+			glDeleteShader(build.fragment);
+		if (build.program)
+			glDeleteProgram(build.program);
+		build = Build();
+	}
+
+	// watcher thread: reads the sources of every program using a changed file
+	void changed(const std::string& path) {
+		for (size_t p = 0; p < programs.size(); p++) {
+			if (programs[p].vertexPath != path && programs[p].fragmentPath != path)
+				continue;
+			TRACE_SCOPE("read shader sources");
+			std::string vertexCode, fragmentCode;
+			if (!readSource(programs[p].vertexPath, vertexCode) || !readSource(programs[p].fragmentPath, fragmentCode))
+				continue;
+			vertexCode = injectDefines(vertexCode, programs[p].features);
+			fragmentCode = injectDefines(fragmentCode, programs[p].features);
+			std::lock_guard<std::mutex> lock(mutex);
+			sources[p].vertexCode.swap(vertexCode);
+			sources[p].fragmentCode.swap(fragmentCode);
+			sources[p].changed = true;
+		}
+	}
+	static bool readSource(const std::string& path, std::string& code) {
+		// an editor may be half way through saving
+		return readShaderFile(path, code) && !code.empty();
+	}
+
+#ifdef __linux__
+	// one watch per directory: editors often save by writing a new file and renaming it over the old one
+	void watchFiles() {
+		Tracer::instance().nameThread("shader watcher");
+		int fd = inotify_init1(IN_NONBLOCK);
+		if (fd < 0) {
+			std::cout << "ERROR::SHADER_RELOAD::INOTIFY_UNAVAILABLE" << std::endl;
+			return;
+		}
+		std::vector<int> watches;
+		std::vector<std::string> directories;
+		for (size_t p = 0; p < programs.size(); p++) {
+			const std::string* paths[2] = { &programs[p].vertexPath, &programs[p].fragmentPath };
+			for (int i = 0; i < 2; i++) {
+				std::string directory = directoryOf(*paths[i]);
+				if (std::find(directories.begin(), directories.end(), directory) != directories.end())
+					continue;
+				int wd = inotify_add_watch(fd, directory.empty() ? "." : directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+				if (wd < 0)
+					continue;
+				watches.push_back(wd);
+				directories.push_back(directory);
+			}
+		}
+		alignas(struct inotify_event) char buffer[4096];
+		while (!stopping) {
+			pollfd waiting = { fd, POLLIN, 0 };
+			if (poll(&waiting, 1, 100) <= 0)
+				continue;
+			ssize_t length;
+			while ((length = read(fd, buffer, sizeof(buffer))) > 0) {
+				for (char* at = buffer; at < buffer + length; ) {
+					const inotify_event* event = reinterpret_cast<const inotify_event*>(at);
+					at += sizeof(inotify_event) + event->len;
+					size_t w = std::find(watches.begin(), watches.end(), event->wd) - watches.begin();
+					if (event->len == 0 || w == watches.size())
+						continue;
+					changed(directories[w] + event->name);
+				}
+			}
+		}
+		close(fd);
+	}
+	static std::string directoryOf(const std::string& path) {
+		size_t slash = path.find_last_of('/');
+		return slash == std::string::npos ? std::string() : path.substr(0, slash + 1);
+	}
+#else
+	// polls the modification times four times a second
+	void watchFiles() {
+		Tracer::instance().nameThread("shader watcher");
+		std::vector<std::string> paths;
+		for (size_t p = 0; p < programs.size(); p++) {
+			paths.push_back(programs[p].vertexPath);
+			paths.push_back(programs[p].fragmentPath);
+		}
+		std::vector<long long> stamps(paths.size());
+		for (size_t i = 0; i < paths.size(); i++)
+			stamps[i] = fileStamp(paths[i]);
+		while (!stopping) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(250));
+			for (size_t i = 0; i < paths.size(); i++) {
+				long long stamp = fileStamp(paths[i]);
+				if (stamp == stamps[i])
+					continue;
+				stamps[i] = stamp;
+				changed(paths[i]);
+			}
+		}
+	}
+	static long long fileStamp(const std::string& path) {
+#ifdef _WIN32
+		struct _stat info;
+		if (_stat(path.c_str(), &info) != 0)
+			return -1;
+#else
+		struct stat info;
+		if (stat(path.c_str(), &info) != 0)
+			return -1;
+#endif
+		return static_cast<long long>(info.st_mtime) * 1000003 + info.st_size;
+	}
+#endif
+};
+
+#endif
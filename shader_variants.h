@@ -0,0 +1,124 @@
+#pragma once
+#ifndef shader_variants_h
+#define shader_variants_h
+
+#include "shader.h"
+#include "shader_cache.h"
+#include <fstream>
+#include <initializer_list>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// Features a shader variant is compiled with; each turns on the #ifdef block of the same
+// name (SHADER_FEATURE_DEFINES) in the shader sources. A feature is only added together
+// with its #ifdef block, so no two variants compile the same code.
+enum Shader_Feature {
+	SHADER_LIT = 1,			// clustered lighting and colour output; without it the variant only writes depth
+	SHADER_SHADOWED = 2		// the lamps' shadow maps
+};
+const unsigned int SHADER_FEATURE_COUNT = 2;
+const unsigned int SHADER_VARIANT_COUNT = 1u << SHADER_FEATURE_COUNT;
+const char* const SHADER_FEATURE_DEFINES[SHADER_FEATURE_COUNT] = { "LIT", "SHADOWED" };
+
+// A set of Shader_Feature bits; also the index of its variant
+struct ShaderFeatures {
+	unsigned int bits;
+
+	constexpr ShaderFeatures(unsigned int bits = 0) : bits(bits) {
+	}
+	constexpr bool has(Shader_Feature feature) const {
+		return (bits & feature) != 0;
+	}
+};
+inline constexpr ShaderFeatures operator|(ShaderFeatures a, ShaderFeatures b) {
+	return ShaderFeatures(a.bits | b.bits);
+}
+
+// the source with a #define per feature after its #version line; #line keeps
+// compiler messages pointing at the lines of the file
+inline std::string injectDefines(const std::string& source, ShaderFeatures features) {
+	std::string defines;
+	for (unsigned int f = 0; f < SHADER_FEATURE_COUNT; f++)
+		if (features.bits & (1u << f))
+			defines += std::string("#define ") + SHADER_FEATURE_DEFINES[f] + "\n";
+	size_t version = source.find("#version");
+	if (version == std::string::npos)
+		return defines + source;
+	size_t lineEnd = source.find('\n', version);
+	if (lineEnd == std::string::npos)
+		return source + "\n" + defines;
+	int line = 2;
+	for (size_t i = 0; i < version; i++)
+		if (source[i] == '\n')
+			line++;
+	return source.substr(0, lineEnd + 1) + defines + "#line " + std::to_string(line) + "\n" + source.substr(lineEnd + 1);
+}
+
+inline bool readShaderFile(const std::string& path, std::string& code) {
+	std::ifstream file(path.c_str());
+	if (!file)
+		return false;
+	std::stringstream stream;
+	stream << file.rdbuf();
+	code = stream.str();
+	return true;
+}
+
+// Every feature combination of one vertex + fragment source pair. A variant is compiled
+// the first time it is asked for, or up front with prewarm(); after that, picking one is
+// an index into an array. Give the features as a template argument where they are fixed,
+// get<SHADER_LIT | SHADER_SHADOWED>(), to have them checked at compile time.
+class ShaderVariants {
+
+public:
+	std::string vertexPath, fragmentPath;
+
+	ShaderVariants(const std::string& vertexPath, const std::string& fragmentPath, ShaderCache* cache = NULL)
+		: vertexPath(vertexPath), fragmentPath(fragmentPath), cache(cache) {
+	}
+
+	Shader& get(ShaderFeatures features) {
+		Shader& shader = variants[features.bits];
+		if (!shader.ID)
+			build(features);
+		return shader;
+	}
+	template <unsigned int Features>
+	Shader& get() {
+		static_assert(Features < SHADER_VARIANT_COUNT, "not a combination of Shader_Feature bits");
+		return get(ShaderFeatures(Features));
+	}
+
+	// compiles these now, so no frame has to wait for them later
+	void prewarm(std::initializer_list<ShaderFeatures> features) {
+		for (ShaderFeatures f : features)
+			get(f);
+	}
+
+	// the variant's slot, built or not (ID 0); for the hot reloader
+	Shader& variant(unsigned int bits) {
+		return variants[bits];
+	}
+	int built() const {
+		int count = 0;
+		for (unsigned int v = 0; v < SHADER_VARIANT_COUNT; v++)
+			if (variants[v].ID)
+				count++;
+		return count;
+	}
+
+private:
+	ShaderCache* cache;
+	Shader variants[SHADER_VARIANT_COUNT];
+
+	// the files are read again for every variant, so one built late sees the latest edit
+	void build(ShaderFeatures features) {
+		std::string vertexCode, fragmentCode;
+		if (!readShaderFile(vertexPath, vertexCode) || !readShaderFile(fragmentPath, fragmentCode))
+			std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << vertexPath << " + " << fragmentPath << std::endl;
+		variants[features.bits].compile(injectDefines(vertexCode, features), injectDefines(fragmentCode, features), cache);
+	}
+};
+
+#endif
@@ -0,0 +1,203 @@
+#pragma once
+#ifndef shadow_h
+#define shadow_h
+
+#include "shader.h"
+#include "lighting.h"
+#include "render_queue.h"
+#include "viewport.h"
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <iostream>
+#include <string>
+#include <vector>
+
+// must match MAX_SHADOWS in fragmentShader.fs
+const int MAX_SHADOWS = 8;
+const int SHADOW_MAP_SIZE = 1024;
+const int SHADOW_TEXTURE_UNIT = 4;
+// lamps hang just under the ceiling: their shadows are cast by a downward cone this wide
+const float SHADOW_FOV = 120.0f;
+
+// Shadow maps for the main lamps, one layer of a depth texture array each, rendered
+// from the lamp looking straight down. Everything except the fan blades is static,
+// so the static casters are rendered once into a cached array. The live array the
+// shader samples is a copy of that cache, and when the blades have moved only the
+// layers they can reach are refreshed: a depth blit from the cache plus the four
+// blades drawn on top. A frame in which nothing moved costs no shadow work at all.
+class ShadowMaps {
+
+public:
+	ShadowMaps() : liveTexture(0), cachedTexture(0), FBO(0), readFBO(0), staticDirty(true), dynamicValid(false) {
+	}
+
+	// creates the maps for the given lights (at most MAX_SHADOWS) and tags them in 'lighting'
+	void init(Lighting& lighting, const std::vector<int>& shadowedLights) {
+		for (size_t i = 0; i < shadowedLights.size() && layers.size() < static_cast<size_t>(MAX_SHADOWS); i++) {
+			PointLight& light = lighting.lights[shadowedLights[i]];
+			light.shadowLayer = static_cast<int>(layers.size());
+			Layer layer = { light.position, light.radius, glm::mat4(1.0f), glm::mat4(1.0f), glm::mat4(1.0f), false };
+			layers.push_back(layer);
+		}
+		if (shadowedLights.size() > layers.size())
+			std::cout << "SHADOW::TOO_MANY_SHADOWED_LIGHTS: only " << MAX_SHADOWS << " lights cast shadows" << std::endl;
+		lighting.markDirty();
+
+		int count = std::max(1, static_cast<int>(layers.size()));
+		unsigned int* textures[2] = { &liveTexture, &cachedTexture };
+		for (int t = 0; t < 2; t++) {
+			glGenTextures(1, textures[t]);
+			glBindTexture(GL_TEXTURE_2D_ARRAY, *textures[t]);
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, count, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			// hardware depth comparison: bilinear filtering then gives 2x2 PCF for free
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+			glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+		}
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+		glGenFramebuffers(1, &FBO);
+		glGenFramebuffers(1, &readFBO);
+		// depth only: without colour buffers both framebuffers must say so to be complete
+		// (the blit in copyLayer() reads from readFBO)
+		unsigned int framebuffers[2] = { FBO, readFBO }, attached[2] = { liveTexture, cachedTexture };
+		const char* names[2] = { "FBO", "readFBO" };
+		for (int f = 0; f < 2; f++) {
+			glBindFramebuffer(GL_FRAMEBUFFER, framebuffers[f]);
+			glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, attached[f], 0, 0);
+			glDrawBuffer(GL_NONE);
+			glReadBuffer(GL_NONE);
+			GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+			if (status != GL_FRAMEBUFFER_COMPLETE)
+				std::cout << "SHADOW::FRAMEBUFFER_INCOMPLETE: " << names[f] << " status 0x" << std::hex << status << std::dec << std::endl;
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		staticDirty = true;
+		dynamicValid = false;
+	}
+
+	void release() {
+		glDeleteTextures(1, &liveTexture);
+		glDeleteTextures(1, &cachedTexture);
+		glDeleteFramebuffers(1, &FBO);
+		glDeleteFramebuffers(1, &readFBO);
+	}
+
+	// static geometry or the shadowed lights changed: rebuild the cache on the next update
+	void markStaticDirty() {
+		staticDirty = true;
+	}
+
+	// brings the live maps up to date; restores the default framebuffer and the viewport
+	void update(const RenderQueue& scene, const Shader& depthShader, float time, const Viewport& viewport) {
+		std::vector<float> angles;
+		for (size_t i = 0; i < scene.items.size(); i++)
+			if (scene.items[i].spin)
+				angles.push_back(scene.items[i].spin->angleAt(time));
+		if (!staticDirty && dynamicValid && angles == dynamicAngles)
+			return;
+
+		depthShader.use();
+		depthShader.setFloat("time", time);
+		glViewport(0, 0, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE);
+		glEnable(GL_POLYGON_OFFSET_FILL);
+		glPolygonOffset(2.0f, 4.0f);
+		glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+
+		if (staticDirty) {
+			for (size_t l = 0; l < layers.size(); l++) {
+				Layer& layer = layers[l];
+				layer.projection = glm::perspective(glm::radians(SHADOW_FOV), 1.0f, 0.05f, layer.radius);
+				layer.view = glm::lookAt(layer.position, layer.position - glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, -1.0f));
+				layer.lightSpace = layer.projection * layer.view;
+				layer.dynamic = reachesDynamic(scene, layer);
+				renderLayer(scene, depthShader, cachedTexture, static_cast<int>(l), DRAW_STATIC);
+				// layers no moving part can reach are copied once and never touched again
+				copyLayer(static_cast<int>(l));
+			}
+			staticDirty = false;
+		}
+		for (size_t l = 0; l < layers.size(); l++) {
+			if (!layers[l].dynamic)
+				continue;
+			copyLayer(static_cast<int>(l));
+			renderLayer(scene, depthShader, liveTexture, static_cast<int>(l), DRAW_DYNAMIC);
+		}
+		dynamicAngles = angles;
+		dynamicValid = true;
+
+		glDisable(GL_POLYGON_OFFSET_FILL);
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glViewport(0, 0, viewport.width, viewport.height);
+	}
+
+	// binds the live maps and the light-space matrices for the lighting shader
+	void apply(const Shader& shader) const {
+		glActiveTexture(GL_TEXTURE0 + SHADOW_TEXTURE_UNIT);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, liveTexture);
+		glActiveTexture(GL_TEXTURE0);
+		shader.setInt("shadowMaps", SHADOW_TEXTURE_UNIT);
+		for (size_t l = 0; l < layers.size(); l++)
+			shader.setMat4("shadowMatrices[" + std::to_string(l) + "]", layers[l].lightSpace);
+	}
+
+private:
+	struct Layer {
+		glm::vec3 position;		// of the light, taken at init()
+		float radius;
+		glm::mat4 view, projection;
+		glm::mat4 lightSpace;	// projection * view, for the lighting shader
+		bool dynamic;			// a moving part can cast into this layer
+	};
+
+	std::vector<Layer> layers;
+	unsigned int liveTexture, cachedTexture;
+	unsigned int FBO, readFBO;
+	bool staticDirty;
+	bool dynamicValid;
+	std::vector<float> dynamicAngles;	// spin angles the live maps were rendered with
+
+	void renderLayer(const RenderQueue& scene, const Shader& depthShader, unsigned int texture, int layer, int kinds) {
+		glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, texture, 0, layer);
+		if (kinds & DRAW_STATIC)
+			glClear(GL_DEPTH_BUFFER_BIT);
+		depthShader.setMat4("view", layers[layer].view);
+		depthShader.setMat4("projection", layers[layer].projection);
+		scene.drawDepth(depthShader, kinds);
+	}
+
+	// live layer = cached layer (static casters only)
+	void copyLayer(int layer) {
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, readFBO);
+		glFramebufferTextureLayer(GL_READ_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, cachedTexture, 0, layer);
+		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, FBO);
+		glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, liveTexture, 0, layer);
+		glBlitFramebuffer(0, 0, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, 0, 0, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+		glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+	}
+
+	// whether any spinning draw's swept sphere overlaps the light's range
+	static bool reachesDynamic(const RenderQueue& scene, const Layer& light) {
+		for (size_t i = 0; i < scene.items.size(); i++) {
+			const DrawItem& item = scene.items[i];
+			if (!item.spin)
+				continue;
+			float sweep = 0.0f;
+			for (int corner = 0; corner < 8; corner++) {
+				glm::vec3 local(corner & 1 ? item.mesh->boundsMax.x : item.mesh->boundsMin.x,
+					corner & 2 ? item.mesh->boundsMax.y : item.mesh->boundsMin.y,
+					corner & 4 ? item.mesh->boundsMax.z : item.mesh->boundsMin.z);
+				sweep = std::max(sweep, glm::length(glm::vec3(item.model * glm::vec4(local, 1.0f)) - item.spin->pivot));
+			}
+			if (glm::length(item.spin->pivot - light.position) < light.radius + sweep)
+				return true;
+		}
+		return false;
+	}
+};
+
+#endif
@@ -0,0 +1,400 @@
+#pragma once
+#ifndef software_raster_h
+#define software_raster_h
+
+#include "render_backend.h"
+#include "render_queue.h"
+#include "lighting.h"
+#include "job_pool.h"
+#include "trace.h"
+#include "mesh.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <vector>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define RASTER_SSE 1
+#include <emmintrin.h>
+#endif
+
+// screen tiles the rasteriser bins triangles into; one job per tile
+const int RASTER_TILE_SIZE = 64;
+
+// A CPU implementation of the renderer for machines without a GPU. It draws the same
+// RenderQueue with the same meshes, transforms, spin and point lights as the OpenGL
+// backend (per-pixel Blinn-Phong with the same falloff; no shadow maps):
+//  1. geometry: every draw's vertices are transformed in parallel (one job per draw),
+//     triangles are clipped against the near plane and set up in screen space;
+//  2. binning: each triangle is added to the list of every tile its bounds touch;
+//  3. raster: tiles are rasterised in parallel (one job per tile, so no two threads ever
+//     touch the same pixel), testing four pixels at a time with SSE edge functions
+//     and depth compares. Like the GL depth pre-pass, a pixel only remembers its nearest
+//     triangle and barycentrics, and is shaded once after the whole tile is resolved.
+class SoftwareBackend : public RenderBackend {
+
+public:
+	glm::vec3 clearColor;
+	// statistics of the last frame
+	long long trianglesSubmitted;
+	long long trianglesRasterized;	// after clipping and trivial rejection
+	double milliseconds;
+
+	SoftwareBackend(int width = 800, int height = 600)
+		: clearColor(0.2f, 0.3f, 0.3f), trianglesSubmitted(0), trianglesRasterized(0), milliseconds(0.0),
+		width(0), height(0), tilesX(0), tilesY(0), lighting(NULL), eye(0.0f) {
+		resize(width, height);
+		jobs.start();
+	}
+
+	void resize(int newWidth, int newHeight) {
+		width = std::max(1, newWidth);
+		height = std::max(1, newHeight);
+		tilesX = (width + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+		tilesY = (height + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+		color.assign(static_cast<size_t>(width) * height, 0);
+		depth.assign(static_cast<size_t>(width) * height, 1.0f);
+		visible.assign(static_cast<size_t>(width) * height, NULL);
+		weights.resize(static_cast<size_t>(width) * height);
+		bins.resize(tilesX * tilesY);
+	}
+
+	int threadCount() const {
+		return jobs.threadCount();
+	}
+
+	const char* name() const {
+		return "software";
+	}
+
+	void render(RenderQueue& scene, Lighting& sceneLighting, const FrameParams& frame) {
+		TRACE_SCOPE("software render");
+		std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		if (frame.viewport.width != width || frame.viewport.height != height)
+			resize(frame.viewport.width, frame.viewport.height);
+		lighting = &sceneLighting;
+		eye = frame.eye;
+		viewProjection = frame.projection * frame.view;
+		time = frame.time;
+
+		// 1. geometry, one job per draw
+		triangles.resize(scene.items.size());
+		jobs.run(static_cast<int>(scene.items.size()), [&](int i) { transform(scene.items[i], triangles[i]); });
+
+		// 2. binning, nearest draws first so the depth test rejects hidden pixels before shading
+		scene.sortFrontToBack(eye);
+		trianglesSubmitted = trianglesRasterized = 0;
+		for (size_t b = 0; b < bins.size(); b++)
+			bins[b].clear();
+		for (size_t o = 0; o < scene.order.size(); o++) {
+			int i = scene.order[o];
+			trianglesSubmitted += scene.items[i].mesh->indexCount / 3;
+			trianglesRasterized += triangles[i].size();
+			for (size_t t = 0; t < triangles[i].size(); t++) {
+				const Triangle& tri = triangles[i][t];
+				for (int ty = tri.minY / RASTER_TILE_SIZE; ty <= tri.maxY / RASTER_TILE_SIZE; ty++)
+					for (int tx = tri.minX / RASTER_TILE_SIZE; tx <= tri.maxX / RASTER_TILE_SIZE; tx++)
+						bins[ty * tilesX + tx].push_back(&tri);
+			}
+		}
+
+		// 3. raster, one job per tile
+		jobs.run(tilesX * tilesY, [this](int tile) { rasterTile(tile); });
+		milliseconds = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// the framebuffer is already in memory: a request is a copy, there is nothing to wait for
+	void requestPixels() {
+		requested.push_back(FrameImage());
+		FrameImage& image = requested.back();
+		image.width = width;
+		image.height = height;
+		image.renderMilliseconds = milliseconds;
+		image.rgba.resize(color.size() * 4);
+		for (size_t p = 0; p < color.size(); p++) {
+			image.rgba[p * 4] = static_cast<unsigned char>(color[p] & 0xff);
+			image.rgba[p * 4 + 1] = static_cast<unsigned char>((color[p] >> 8) & 0xff);
+			image.rgba[p * 4 + 2] = static_cast<unsigned char>((color[p] >> 16) & 0xff);
+			image.rgba[p * 4 + 3] = static_cast<unsigned char>(color[p] >> 24);
+		}
+	}
+	// the frame is finished when render() returns, so there is never anything to wait for
+	bool readPixels(FrameImage& image, bool /*wait*/) {
+		if (requested.empty())
+			return false;
+		image.rgba.swap(requested.front().rgba);
+		image.width = requested.front().width;
+		image.height = requested.front().height;
+		image.renderMilliseconds = requested.front().renderMilliseconds;
+		requested.pop_front();
+		return true;
+	}
+
+private:
+	// a vertex after the vertex stage
+	struct ClipVertex {
+		glm::vec4 clip;
+		glm::vec3 world, normal, color;
+	};
+	// a triangle set up for rasterisation; attributes are pre-divided by w so they
+	// interpolate linearly in screen space (perspective-correct after dividing by 1/w)
+	struct Triangle {
+		float x[3], y[3], z[3], invW[3];
+		glm::vec3 world[3], normal[3], color[3];
+		const Material* material;
+		int minX, minY, maxX, maxY;	// pixel bounds, inclusive
+	};
+
+	int width, height;
+	int tilesX, tilesY;
+	std::vector<unsigned int> color;	// RGBA8, bottom row first
+	std::vector<float> depth;		// [0, 1], cleared to 1
+	std::vector<const Triangle*> visible;	// nearest triangle per pixel, NULL for the background
+	std::vector<glm::vec2> weights;		// its barycentrics at the pixel (the third is 1 - x - y)
+	std::vector<std::vector<Triangle> > triangles;	// per draw
+	std::vector<std::vector<const Triangle*> > bins;	// per tile
+	std::deque<FrameImage> requested;	// copies made by requestPixels(), oldest first
+	JobPool jobs;
+
+	// per-frame state read by the jobs
+	const Lighting* lighting;
+	glm::vec3 eye;
+	glm::mat4 viewProjection;
+	float time;
+
+	// vertex stage, clipping and triangle setup for one draw
+	void transform(const DrawItem& item, std::vector<Triangle>& out) const {
+		out.clear();
+		const Mesh& mesh = *item.mesh;
+		glm::mat3 normalMatrix = glm::transpose(glm::inverse(glm::mat3(item.model)));
+		// same spin as vertexShader.vs
+		float angle = item.spin ? glm::radians(item.spin->angleAt(time)) : 0.0f;
+		float c = std::cos(angle), s = std::sin(angle);
+
+		size_t vertexCount = mesh.vertices.size() / MESH_STRIDE;
+		std::vector<ClipVertex> vertices(vertexCount);
+		for (size_t v = 0; v < vertexCount; v++) {
+			const float* data = &mesh.vertices[v * MESH_STRIDE];
+			glm::vec3 world = glm::vec3(item.model * glm::vec4(data[0], data[1], data[2], 1.0f));
+			glm::vec3 normal = normalMatrix * glm::vec3(data[6], data[7], data[8]);
+			if (angle != 0.0f) {
+				world = item.spin->pivot + rotate(world - item.spin->pivot, item.spin->axis, c, s);
+				normal = rotate(normal, item.spin->axis, c, s);
+			}
+			vertices[v].clip = viewProjection * glm::vec4(world, 1.0f);
+			vertices[v].world = world;
+			vertices[v].normal = normal;
+			vertices[v].color = glm::vec3(data[3], data[4], data[5]);
+		}
+
+		for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+			ClipVertex polygon[4];
+			int count = clipNear(vertices[mesh.indices[i]], vertices[mesh.indices[i + 1]], vertices[mesh.indices[i + 2]], polygon);
+			for (int k = 1; k + 1 < count; k++)
+				setup(polygon[0], polygon[k], polygon[k + 1], mesh.material, out);
+		}
+	}
+
+	static glm::vec3 rotate(const glm::vec3& v, const glm::vec3& axis, float c, float s) {
+		return v * c + glm::cross(axis, v) * s + axis * glm::dot(axis, v) * (1.0f - c);
+	}
+
+	static ClipVertex lerp(const ClipVertex& a, const ClipVertex& b, float t) {
+		ClipVertex r;
+		r.clip = a.clip + (b.clip - a.clip) * t;
+		r.world = a.world + (b.world - a.world) * t;
+		r.normal = a.normal + (b.normal - a.normal) * t;
+		r.color = a.color + (b.color - a.color) * t;
+		return r;
+	}
+
+	// Sutherland-Hodgman against the near plane (z >= -w); returns 0, 3 or 4 vertices.
+	// The other planes are handled by the screen bounds and the depth range.
+	static int clipNear(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c, ClipVertex out[4]) {
+		const ClipVertex* in[3] = { &a, &b, &c };
+		int count = 0;
+		for (int i = 0; i < 3; i++) {
+			const ClipVertex& p = *in[i];
+			const ClipVertex& q = *in[(i + 1) % 3];
+			float dp = p.clip.z + p.clip.w, dq = q.clip.z + q.clip.w;
+			if (dp >= 0.0f)
+				out[count++] = p;
+			if ((dp >= 0.0f) != (dq >= 0.0f))
+				out[count++] = lerp(p, q, dp / (dp - dq));
+		}
+		return count;
+	}
+
+	void setup(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c, const Material& material, std::vector<Triangle>& out) const {
+		const ClipVertex* v[3] = { &a, &b, &c };
+		// entirely outside one of the side or far planes
+		for (int axis = 0; axis < 3; axis++) {
+			if (a.clip[axis] > a.clip.w && b.clip[axis] > b.clip.w && c.clip[axis] > c.clip.w)
+				return;
+			if (axis < 2 && a.clip[axis] < -a.clip.w && b.clip[axis] < -b.clip.w && c.clip[axis] < -c.clip.w)
+				return;
+		}
+		Triangle t;
+		for (int k = 0; k < 3; k++) {
+			float invW = 1.0f / v[k]->clip.w;
+			t.x[k] = (v[k]->clip.x * invW * 0.5f + 0.5f) * width;
+			t.y[k] = (v[k]->clip.y * invW * 0.5f + 0.5f) * height;
+			t.z[k] = v[k]->clip.z * invW * 0.5f + 0.5f;
+			t.invW[k] = invW;
+			t.world[k] = v[k]->world * invW;
+			t.normal[k] = v[k]->normal * invW;
+			t.color[k] = v[k]->color * invW;
+		}
+		// no face culling, as in the GL backend: wind every triangle counter-clockwise
+		float area = (t.x[1] - t.x[0]) * (t.y[2] - t.y[0]) - (t.x[2] - t.x[0]) * (t.y[1] - t.y[0]);
+		if (area == 0.0f || area != area)
+			return;
+		if (area < 0.0f) {
+			std::swap(t.x[1], t.x[2]);
+			std::swap(t.y[1], t.y[2]);
+			std::swap(t.z[1], t.z[2]);
+			std::swap(t.invW[1], t.invW[2]);
+			std::swap(t.world[1], t.world[2]);
+			std::swap(t.normal[1], t.normal[2]);
+			std::swap(t.color[1], t.color[2]);
+		}
+		float minX = std::min(t.x[0], std::min(t.x[1], t.x[2])), maxX = std::max(t.x[0], std::max(t.x[1], t.x[2]));
+		float minY = std::min(t.y[0], std::min(t.y[1], t.y[2])), maxY = std::max(t.y[0], std::max(t.y[1], t.y[2]));
+		t.minX = std::max(0, static_cast<int>(std::floor(minX)));
+		t.minY = std::max(0, static_cast<int>(std::floor(minY)));
+		t.maxX = std::min(width - 1, static_cast<int>(std::ceil(maxX)));
+		t.maxY = std::min(height - 1, static_cast<int>(std::ceil(maxY)));
+		if (t.minX > t.maxX || t.minY > t.maxY)
+			return;
+		t.material = &material;
+		out.push_back(t);
+	}
+
+	void rasterTile(int tile) {
+		int x0 = (tile % tilesX) * RASTER_TILE_SIZE, y0 = (tile / tilesX) * RASTER_TILE_SIZE;
+		int x1 = std::min(x0 + RASTER_TILE_SIZE, width) - 1, y1 = std::min(y0 + RASTER_TILE_SIZE, height) - 1;
+		for (int y = y0; y <= y1; y++) {
+			size_t row = static_cast<size_t>(y) * width;
+			std::fill(&depth[row + x0], &depth[row + x1] + 1, 1.0f);
+			std::fill(&visible[row + x0], &visible[row + x1] + 1, static_cast<const Triangle*>(NULL));
+		}
+		const std::vector<const Triangle*>& bin = bins[tile];
+		for (size_t i = 0; i < bin.size(); i++)
+			rasterTriangle(*bin[i], std::max(x0, bin[i]->minX), std::max(y0, bin[i]->minY), std::min(x1, bin[i]->maxX), std::min(y1, bin[i]->maxY));
+
+		unsigned int clear = pack(clearColor);
+		for (int y = y0; y <= y1; y++) {
+			for (size_t p = static_cast<size_t>(y) * width + x0; p <= static_cast<size_t>(y) * width + x1; p++)
+				color[p] = visible[p] ? shade(*visible[p], weights[p].x, weights[p].y, 1.0f - weights[p].x - weights[p].y) : clear;
+		}
+	}
+
+	// edge functions: e_k(x, y) = a_k * x + b_k * y + c_k, positive inside; e_k is the
+	// weight of vertex k (it is measured from the edge opposite to it)
+	void rasterTriangle(const Triangle& t, int x0, int y0, int x1, int y1) {
+		float a[3], b[3], c[3];
+		for (int k = 0; k < 3; k++) {
+			int i = (k + 1) % 3, j = (k + 2) % 3;
+			a[k] = t.y[i] - t.y[j];
+			b[k] = t.x[j] - t.x[i];
+			c[k] = t.x[i] * t.y[j] - t.x[j] * t.y[i];
+		}
+		float inverseArea = 1.0f / (c[0] + c[1] + c[2]);
+		for (int y = y0; y <= y1; y++) {
+			float py = y + 0.5f;
+			size_t row = static_cast<size_t>(y) * width;
+			int x = x0;
+#ifdef RASTER_SSE
+			const __m128 offsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+			for (; x <= x1; x += 4) {
+				__m128 px = _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), offsets);
+				__m128 e0 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[0]), px), _mm_set1_ps(b[0] * py + c[0]));
+				__m128 e1 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[1]), px), _mm_set1_ps(b[1] * py + c[1]));
+				__m128 e2 = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(a[2]), px), _mm_set1_ps(b[2] * py + c[2]));
+				__m128 zero = _mm_setzero_ps();
+				__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+				int mask = _mm_movemask_ps(inside);
+				// lanes past the right edge of the clipped rectangle
+				if (x + 3 > x1)
+					mask &= (1 << (x1 - x + 1)) - 1;
+				if (!mask)
+					continue;
+				__m128 area = _mm_set1_ps(inverseArea);
+				__m128 w0 = _mm_mul_ps(e0, area), w1 = _mm_mul_ps(e1, area), w2 = _mm_mul_ps(e2, area);
+				__m128 z = _mm_add_ps(_mm_add_ps(_mm_mul_ps(w0, _mm_set1_ps(t.z[0])), _mm_mul_ps(w1, _mm_set1_ps(t.z[1]))), _mm_mul_ps(w2, _mm_set1_ps(t.z[2])));
+				float zs[4], ws[3][4];
+				_mm_storeu_ps(zs, z);
+				_mm_storeu_ps(ws[0], w0);
+				_mm_storeu_ps(ws[1], w1);
+				_mm_storeu_ps(ws[2], w2);
+				for (int lane = 0; lane < 4; lane++) {
+					if (!(mask & (1 << lane)))
+						continue;
+					size_t p = row + x + lane;
+					if (zs[lane] < depth[p] && zs[lane] >= 0.0f) {
+						depth[p] = zs[lane];
+						visible[p] = &t;
+						weights[p] = glm::vec2(ws[0][lane], ws[1][lane]);
+					}
+				}
+			}
+#endif
+			for (; x <= x1; x++) {
+				float px = x + 0.5f;
+				float e[3];
+				for (int k = 0; k < 3; k++)
+					e[k] = a[k] * px + b[k] * py + c[k];
+				if (e[0] < 0.0f || e[1] < 0.0f || e[2] < 0.0f)
+					continue;
+				float w0 = e[0] * inverseArea, w1 = e[1] * inverseArea, w2 = e[2] * inverseArea;
+				float z = w0 * t.z[0] + w1 * t.z[1] + w2 * t.z[2];
+				size_t p = row + x;
+				if (z < depth[p] && z >= 0.0f) {
+					depth[p] = z;
+					visible[p] = &t;
+					weights[p] = glm::vec2(w0, w1);
+				}
+			}
+		}
+	}
+
+	// the fragment stage: same lighting model as fragmentShader.fs, without shadows
+	unsigned int shade(const Triangle& t, float w0, float w1, float w2) const {
+		float w = 1.0f / (w0 * t.invW[0] + w1 * t.invW[1] + w2 * t.invW[2]);
+		glm::vec3 world = (t.world[0] * w0 + t.world[1] * w1 + t.world[2] * w2) * w;
+		glm::vec3 normal = glm::normalize((t.normal[0] * w0 + t.normal[1] * w1 + t.normal[2] * w2) * w);
+		glm::vec3 albedo = (t.color[0] * w0 + t.color[1] * w1 + t.color[2] * w2) * w;
+		const Material& material = *t.material;
+		glm::vec3 viewDir = glm::normalize(eye - world);
+		glm::vec3 result = lighting->ambientColor * albedo * material.ambient;
+		for (size_t l = 0; l < lighting->lights.size(); l++) {
+			const PointLight& light = lighting->lights[l];
+			glm::vec3 toLight = light.position - world;
+			float distance2 = glm::dot(toLight, toLight);
+			if (distance2 >= light.radius * light.radius)
+				continue;
+			float distance = std::sqrt(distance2);
+			glm::vec3 lightDir = toLight / distance;
+			float ratio2 = distance2 / (light.radius * light.radius);
+			float window = glm::clamp(1.0f - ratio2 * ratio2, 0.0f, 1.0f);
+			float attenuation = window * window / (1.0f + distance2);
+			float diffuse = std::max(glm::dot(normal, lightDir), 0.0f);
+			float specular = 0.0f;
+			if (diffuse > 0.0f)
+				specular = std::pow(std::max(glm::dot(normal, glm::normalize(lightDir + viewDir)), 0.0f), material.shininess);
+			result += (albedo * (diffuse * material.diffuse) + glm::vec3(specular * material.specular)) * light.color * (light.intensity * attenuation);
+		}
+		return pack(result);
+	}
+
+	static unsigned int pack(const glm::vec3& rgb) {
+		unsigned int r = static_cast<unsigned int>(glm::clamp(rgb.r, 0.0f, 1.0f) * 255.0f + 0.5f);
+		unsigned int g = static_cast<unsigned int>(glm::clamp(rgb.g, 0.0f, 1.0f) * 255.0f + 0.5f);
+		unsigned int b = static_cast<unsigned int>(glm::clamp(rgb.b, 0.0f, 1.0f) * 255.0f + 0.5f);
+		return r | (g << 8) | (b << 16) | 0xff000000u;
+	}
+};
+
+#endif
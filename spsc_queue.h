@@ -0,0 +1,51 @@
+#pragma once
+#ifndef spsc_queue_h
+#define spsc_queue_h
+
+#include <atomic>
+#include <cstddef>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer thread.
+// push/pop never block; push fails when the queue is full so the producer can decide
+// whether to drop or retry. Capacity must be a power of two.
+template <typename T, size_t Capacity>
+class SpscQueue {
+	static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+	SpscQueue() : head(0), tail(0) {
+	}
+
+	bool push(const T& item) {
+		size_t h = head.load(std::memory_order_relaxed);
+		if (h - tail.load(std::memory_order_acquire) == Capacity)
+			return false;
+		items[h & (Capacity - 1)] = item;
+		head.store(h + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool pop(T& item) {
+		size_t t = tail.load(std::memory_order_relaxed);
+		if (t == head.load(std::memory_order_acquire))
+			return false;
+		item = items[t & (Capacity - 1)];
+		tail.store(t + 1, std::memory_order_release);
+		return true;
+	}
+
+	size_t size() const {
+		return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+	}
+	bool empty() const {
+		return size() == 0;
+	}
+
+private:
+	T items[Capacity];
+	// producer and consumer indices live on separate cache lines to avoid false sharing
+	alignas(64) std::atomic<size_t> head;	// next slot to write
+	alignas(64) std::atomic<size_t> tail;	// next slot to read
+};
+
+#endif
@@ -0,0 +1,220 @@
+#pragma once
+#ifndef stress_scene_h
+#define stress_scene_h
+
+#include "mesh.h"
+#include "render_queue.h"
+#include "lighting.h"
+#include "table_sofa.h"
+#include "tool.h"
+#include "glass.h"
+#include "fan.h"
+#include "shadow.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cmath>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <random>
+
+// hall grid: a table with its chairs, a stool beside it and an aisle, then the next row
+const float HALL_CELL_X = 4.5f;
+const float HALL_CELL_Z = 2.5f;
+const float HALL_FLOOR_HEIGHT = 3.6f;	// floor to floor
+const int HALL_RACK_SLOTS = 4;			// glass places per shelf of a rack segment
+const int HALL_MAX_TABLES = 100;		// per side of a floor when sized from an object count
+
+// The restaurant's meshes the halls are built from (named as in main)
+struct HallMeshes {
+	const Mesh *floor, *ceiling, *frontWall, *sideWall, *cabinet;
+	const Mesh *tableTop, *tableLeg, *chairSide, *chairBack, *circle;
+	const Mesh *fanCup, *fanRod, *fanBlade;
+};
+
+struct HallLayout {
+	int tablesX, tablesZ;	// tables per row, rows per floor
+	int floors;
+	float glassDensity;		// share of the rack places that hold a glass
+	unsigned int seed;
+};
+
+// Stress-test scenes: the restaurant's furniture tiled into halls of N x M tables on K
+// floors stacked above each other. Every table gets a stool and a lamp (up to
+// MAX_LIGHTS), every 2 x 2 tables a fan, and every row a rack on either wall with glasses
+// on random shelves, drawn from a seeded generator so a layout is the same on every run.
+// Tables, stools and glasses are occlusion groups like in the restaurant, and fans turn
+// with the restaurant's fan toggle. Halls open towards +z at z = 3 like the restaurant,
+// so the start camera looks into the ground floor.
+class StressScene {
+
+public:
+	bool active;
+	HallLayout layout;
+	std::deque<Fan> fans;	// each spins about its own hub; a deque keeps them in place
+	int tables, stools, glasses;
+	std::vector<int> shadowedLamps;	// the ground floor's front row, nearest the start camera
+
+	StressScene() : active(false), tables(0), stools(0), glasses(0) {
+		HallLayout defaults = { 4, 4, 1, 0.5f, 4208 };
+		layout = defaults;
+	}
+
+	// tables, stools, glasses and fans
+	int objects() const {
+		return tables + stools + glasses + static_cast<int>(fans.size());
+	}
+
+	// "<objects>" sizes square floors to about that many objects, "<N>x<M>[x<K>]" gives the tables
+	bool parse(const char* text) {
+		int x = 0, z = 0, floors = 1;
+		if (strchr(text, 'x')) {
+			if (sscanf(text, "%dx%dx%d", &x, &z, &floors) < 2 || x < 1 || z < 1 || floors < 1)
+				return badLayout(text);
+			layout.tablesX = x;
+			layout.tablesZ = z;
+			layout.floors = floors;
+		}
+		else {
+			// the whole text must be the count: "abc" or "1e5" are not quietly one object
+			char* end = NULL;
+			long objects = strtol(text, &end, 10);
+			if (end == text || *end != '\0' || objects < 1 || objects > INT_MAX)
+				return badLayout(text);
+			sizeFor(static_cast<int>(objects));
+		}
+		active = true;
+		return true;
+	}
+
+	// a floor of s x s tables holds about 2.25 s^2 + 12 s objects (tables, stools, fans,
+	// glasses at the default density); floors are added until s fits HALL_MAX_TABLES
+	void sizeFor(int objects) {
+		int floors = 1, side = 1;
+		for (;; floors++) {
+			double perFloor = static_cast<double>(objects) / floors;
+			side = std::max(1, static_cast<int>(std::lround((-12.0 + std::sqrt(144.0 + 9.0 * perFloor)) / 4.5)));
+			if (side <= HALL_MAX_TABLES)
+				break;
+		}
+		layout.tablesX = layout.tablesZ = side;
+		layout.floors = floors;
+	}
+
+	// records the halls into an empty queue and adds their lamps
+	void generate(RenderQueue& scene, Lighting& lighting, const HallMeshes& meshes) {
+		std::mt19937 random(layout.seed);
+		std::uniform_real_distribution<float> chance(0.0f, 1.0f);
+		tables = stools = glasses = 0;
+		fans.clear();
+		shadowedLamps.clear();
+		float wallRight = layout.tablesX * HALL_CELL_X + 0.6f;
+		float wallBack = -(layout.tablesZ - 1) * HALL_CELL_Z - 1.0f;
+		float width = wallRight + 0.1f + 2.5f, depth = 3.1f - wallBack;
+		for (int k = 0; k < layout.floors; k++) {
+			float base = k * HALL_FLOOR_HEIGHT;
+
+			// floor, ceiling and walls, at the restaurant's heights
+			scene.category = CATEGORY_ROOM;
+			scene.add(*meshes.floor, place(-2.5f, -0.8f + base, wallBack, width * 2.0f, 0.1f, depth * 2.0f));
+			scene.add(*meshes.ceiling, place(-2.5f, 2.75f + base, wallBack, width * 2.0f, 0.1f, depth * 2.0f));
+			scene.add(*meshes.frontWall, place(-2.5f, -0.75f + base, wallBack, width * 2.0f, 7.0f, 0.2f));
+			scene.add(*meshes.frontWall, place(-2.5f, -0.75f + base, 3.0f, width * 2.0f, 7.0f, 0.2f));
+			scene.add(*meshes.sideWall, place(-2.5f, -0.75f + base, wallBack, 0.2f, 7.0f, depth * 2.0f));
+			scene.add(*meshes.sideWall, place(wallRight, -0.75f + base, wallBack, 0.2f, 7.0f, depth * 2.0f));
+
+			for (int j = 0; j < layout.tablesZ; j++) {
+				float rowZ = -j * HALL_CELL_Z;
+				// a rack segment on either wall, three shelves of glasses each
+				float segment = rowZ - 0.6f;
+				const float rackX[2] = { -2.35f, wallRight - 1.05f }, panelX[2] = { -2.35f, wallRight - 0.15f };
+				const float glassX[2] = { -2.0f, wallRight - 0.9f };	// offsets of Glass, whose glass sits at x + 0.25
+				for (int side = 0; side < 2; side++) {
+					scene.category = CATEGORY_ROOM;
+					scene.add(*meshes.cabinet, place(panelX[side], -0.75f + base, segment, 0.2f, 5.0f, HALL_CELL_Z * 2.0f));
+					for (int shelf = 0; shelf < 3; shelf++)
+						scene.add(*meshes.cabinet, place(rackX[side], -0.625f + shelf + base, segment, 2.0f, 0.2f, HALL_CELL_Z * 2.0f));
+					scene.category = CATEGORY_GLASSES;
+					for (int shelf = 0; shelf < 3; shelf++)
+						for (int slot = 0; slot < HALL_RACK_SLOTS; slot++) {
+							if (chance(random) >= layout.glassDensity)
+								continue;
+							// Glass puts its glass at z + 0.8 on the top shelf
+							Glass glass(glassX[side], shelf - 2.0f + base, segment + (slot + 0.5f) * HALL_CELL_Z / HALL_RACK_SLOTS - 0.8f);
+							scene.beginGroup();
+							glass.submit(scene, *meshes.circle);
+							scene.endGroup();
+							glasses++;
+						}
+				}
+
+				for (int i = 0; i < layout.tablesX; i++) {
+					float cellX = i * HALL_CELL_X;
+					scene.category = CATEGORY_TABLES;
+					Table_Sofa table(cellX, base, rowZ);
+					scene.beginGroup();
+					table.submit(scene, *meshes.tableTop, *meshes.tableLeg, *meshes.cabinet, *meshes.chairSide, *meshes.chairBack);
+					scene.endGroup();
+					tables++;
+					scene.category = CATEGORY_TOOLS;
+					Tool stool(cellX + 2.7f, base, rowZ);
+					scene.beginGroup();
+					stool.submit(scene, *meshes.circle, *meshes.tableLeg);
+					scene.endGroup();
+					stools++;
+					// a lamp over the table, as over the restaurant's tables
+					glm::vec3 centre(cellX + 1.375f, base, rowZ + 0.6f);
+					if (static_cast<int>(lighting.lights.size()) < MAX_LIGHTS) {
+						int lamp = lighting.add({ centre + glm::vec3(0.0f, 2.5f, 0.0f), 4.0f, glm::vec3(1.0f, 0.85f, 0.6f), 2.0f });
+						if (k == 0 && j == 0 && static_cast<int>(shadowedLamps.size()) < MAX_SHADOWS)
+							shadowedLamps.push_back(lamp);
+					}
+					// a fan between every 2 x 2 tables; the restaurant's fan has its hub at (2.25, -5.75)
+					if (i % 2 == 0 && j % 2 == 0)
+						addFan(scene, meshes, centre + glm::vec3(HALL_CELL_X * 0.5f - 2.25f, 0.0f, -HALL_CELL_Z * 0.5f + 5.75f));
+				}
+			}
+		}
+		scene.category = CATEGORY_ROOM;
+		printf("stress scene: %dx%d tables on %d floor%s, %d objects (%d tables, %d stools, %d glasses, %d fans), %d draws, %d lights, seed %u\n",
+			layout.tablesX, layout.tablesZ, layout.floors, layout.floors > 1 ? "s" : "", objects(), tables, stools, glasses,
+			static_cast<int>(fans.size()), static_cast<int>(scene.items.size()), static_cast<int>(lighting.lights.size()), layout.seed);
+	}
+
+	// follows the restaurant's fan toggle
+	void spinFans(bool turning, double seconds) {
+		for (size_t f = 0; f < fans.size(); f++) {
+			if (turning)
+				fans[f].spin.start(seconds);
+			else
+				fans[f].spin.stop(seconds);
+		}
+	}
+
+private:
+	static bool badLayout(const char* text) {
+		std::cout << "ERROR::STRESS::BAD_LAYOUT: " << text << " (<objects> or <N>x<M>[x<K>])" << std::endl;
+		return false;
+	}
+
+	static glm::mat4 place(float x, float y, float z, float sx, float sy, float sz) {
+		return glm::scale(glm::translate(glm::mat4(1.0f), glm::vec3(x, y, z)), glm::vec3(sx, sy, sz));
+	}
+
+	// the restaurant's fan, moved by 'offset': cup, rod and hub (as in main), then the blades
+	void addFan(RenderQueue& scene, const HallMeshes& meshes, const glm::vec3& offset) {
+		fans.push_back(Fan(offset.x, offset.y, offset.z));
+		Fan& fan = fans.back();
+		scene.category = CATEGORY_FAN;
+		scene.add(*meshes.fanCup, fan.transforamtion(2, 2.75, -6, 0, 0, 0, 1, -.25, 1));
+		scene.add(*meshes.fanRod, fan.transforamtion(2.125, 2.35, -5.875, 0, 0, 0, .5, .5, .5));
+		scene.add(*meshes.circle, fan.transforamtion(2.25, 2.35, -5.75, 0, 0, 0, .35, 0.1, .35));
+		scene.add(*meshes.circle, fan.transforamtion(2.25, 2.45, -5.75, 0, 0, 180.0f, .35, 0.01, .35));
+		fan.submit(scene, *meshes.fanBlade);
+	}
+};
+
+#endif
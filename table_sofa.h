@@ -2,6 +2,8 @@
 #define table_sofa_h
 
 #include "shader.h"
+#include "mesh.h"
+#include "render_queue.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -35,69 +37,51 @@ public:
 	}
 
 
-	Shader ret_shader(Shader ourShader, unsigned int VAO, unsigned int VAO2, unsigned int VAOC, unsigned int VAO4, unsigned int VAO5) {
+	void submit(RenderQueue& queue, const Mesh& mesh, const Mesh& mesh2, const Mesh& meshC, const Mesh& mesh4, const Mesh& mesh5) {
 		glm::mat4 model;
 		float rotateAngle_X = 0;
 		float rotateAngle_Y = 0;
 		float rotateAngle_Z = 0;
 		//table top
 		model = transforamtion(0, 0, 0.2, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 5.5, 0.2, 1.75);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAOC);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+		queue.add(meshC, model);
 		//Leg side
 		model = transforamtion(0, 0, .57, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 5.5, -1.0, .2);
 		modelMatrices.push_back(model);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAO2);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+		queue.add(mesh2, model);
 
 		//base for legside
 		model = transforamtion(0, -0.75, 0.52, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 5.5, .5, .4);
 		modelMatrices.push_back(model);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAO);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+		queue.add(mesh, model);
 
 
 		//left side outer chair
 		//chair_Top
 		model = transforamtion(0.25, -.35, .8, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 4.5, 0.1, 1);
 		modelMatrices.push_back(model);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAO5);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+		queue.add(mesh5, model);
 		//chair Leg
 		model = transforamtion(0.25, -.35, .8, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 0.1, -.8, 1);
 		modelMatrices.push_back(model);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAO4);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+		queue.add(mesh4, model);
 		//chair Leg
 		model = transforamtion(2.45, -.35, .8, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 0.1, -.8, 1);
 		modelMatrices.push_back(model);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAO4);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+		queue.add(mesh4, model);
 
 		//chair side left one
 		model = transforamtion(0.25, -.3, .8, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 0.1, .3, 1.0);
 		modelMatrices.push_back(model);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAO5);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+		queue.add(mesh5, model);
 		//chair side right one
 		model = transforamtion(2.45, -.3, .8, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 0.1, .3, 1.0);
 		modelMatrices.push_back(model);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAO5);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+		queue.add(mesh5, model);
 		//chair back
 		model = transforamtion(0.25, .15, 1.2, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 4.42, -1.0, 0.2);
 		modelMatrices.push_back(model);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAO5);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+		queue.add(mesh5, model);
 
 
 
@@ -106,43 +90,30 @@ public:
 		//chair_Top
 		model = transforamtion(0.25, -.35, -.075, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 4.5, 0.1, 1);
 		modelMatrices.push_back(model);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAO5);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+		queue.add(mesh5, model);
 
 		//chair Leg
 		model = transforamtion(2.45, -.35, -0.075, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 0.1, -.8, 1);
 		modelMatrices.push_back(model);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAO4);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+		queue.add(mesh4, model);
 		//chair Leg
 		model = transforamtion(0.25, -.35, -0.075, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 0.1, -.8, 1);
 		modelMatrices.push_back(model);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAO4);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+		queue.add(mesh4, model);
 
 		//chair side left one
 		model = transforamtion(0.25, -.3, -.075, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 0.1, .3, 1.0);
 		modelMatrices.push_back(model);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAO5);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+		queue.add(mesh5, model);
 		//chair side right one
 		model = transforamtion(2.45, -.3, -.075, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 0.1, .3, 1.0);
 		modelMatrices.push_back(model);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAO5);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+		queue.add(mesh5, model);
 		//chair back
 		model = transforamtion(0.25, .15, -.075, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 4.42, -1.0, 0.2);
 		modelMatrices.push_back(model);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAO5);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+		queue.add(mesh5, model);
 
-		return ourShader;
 	}
 };
 
@@ -2,6 +2,8 @@
 #define tool_h
 
 #include "shader.h"
+#include "mesh.h"
+#include "render_queue.h"
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
@@ -35,7 +37,7 @@ public:
 	}
 
 
-	Shader ret_shader(Shader ourShader, unsigned int VAO_CIRC, unsigned int VAO2, unsigned int VAO3) {
+	void submit(RenderQueue& queue, const Mesh& meshCirc, const Mesh& mesh2) {
 
 
 
@@ -47,43 +49,30 @@ public:
 		//lower portion
 		model = transforamtion(0.625, -.15, .8, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, .5, 0.1, .5);
 		modelMatrices.push_back(model);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAO_CIRC);
-		glDrawElements(GL_TRIANGLES, 90, GL_UNSIGNED_INT, 0);
+		queue.add(meshCirc, model);
 		//Tool_Top
 		//upper portion
 		model = transforamtion(0.625, -.05, .8, rotateAngle_X, rotateAngle_Y, 180.0f, .5, 0.01, .5);
 		modelMatrices.push_back(model);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAO_CIRC);
-		glDrawElements(GL_TRIANGLES, 90, GL_UNSIGNED_INT, 0);
+		queue.add(meshCirc, model);
 
 		//chair Leg
 		model = transforamtion(0.425, -.2, .5, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 0.1, -1.1, 0.1);
 		modelMatrices.push_back(model);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAO2);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+		queue.add(mesh2, model);
 		//chair Leg
 		model = transforamtion(.875, -.2, .5, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 0.1, -1.1, 0.1);
 		modelMatrices.push_back(model);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAO2);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+		queue.add(mesh2, model);
 
 		//chair Leg
 		model = transforamtion(.875, -.2, 1.035, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 0.1, -1.1, 0.1);
 		modelMatrices.push_back(model);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAO2);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
+		queue.add(mesh2, model);
 		//chair Leg
 		model = transforamtion(0.425, -.2, 1.035, rotateAngle_X, rotateAngle_Y, rotateAngle_Z, 0.1, -1.1, 0.1);
 		modelMatrices.push_back(model);
-		ourShader.setMat4("model", model);
-		glBindVertexArray(VAO2);
-		glDrawElements(GL_TRIANGLES, 36, GL_UNSIGNED_INT, 0);
-		return ourShader;
+		queue.add(mesh2, model);
 	}
 };
 
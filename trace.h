@@ -0,0 +1,185 @@
+#pragma once
+#ifndef trace_h
+#define trace_h
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// events one thread can hold; later ones are counted as dropped
+const int TRACE_EVENTS_PER_THREAD = 1 << 17;
+
+// A finished scope, in microseconds since tracing started. Only the name pointer is
+// kept, so names must be string literals.
+struct TraceEvent {
+	const char* name;
+	long long start;
+	long long duration;
+};
+
+// One thread's events. Only the owning thread writes; it publishes each event by
+// bumping 'count' with release order, so dump() can read everything below 'count'
+// from another thread without a lock.
+struct TraceBuffer {
+	std::vector<TraceEvent> events;
+	std::atomic<int> count;
+	std::atomic<int> dropped;
+	int threadId;
+	std::string threadName;		// under Tracer's mutex
+
+	explicit TraceBuffer(int threadId) : events(TRACE_EVENTS_PER_THREAD), count(0), dropped(0), threadId(threadId) {
+	}
+};
+
+// Collects scoped timing events from every thread (the render loop, uploads, shader
+// compiles, the job pool, the encoder, ...) and writes them as Chrome Trace Event JSON,
+// which chrome://tracing and ui.perfetto.dev open. Recording an event costs two clock
+// reads and a store into the thread's own buffer; the mutex is only taken the first
+// time a thread records and while dumping.
+class Tracer {
+
+public:
+	static Tracer& instance() {
+		static Tracer tracer;
+		return tracer;
+	}
+
+	bool enabled() const {
+		return on.load(std::memory_order_acquire);
+	}
+	void start() {
+		if (enabled())
+			return;
+		origin = std::chrono::steady_clock::now();
+		on.store(true, std::memory_order_release);
+	}
+	long long now() const {
+		return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - origin).count();
+	}
+
+	void record(const char* name, long long start, long long end) {
+		TraceBuffer& buffer = threadBuffer();
+		int n = buffer.count.load(std::memory_order_relaxed);
+		if (n >= TRACE_EVENTS_PER_THREAD) {
+			buffer.dropped.fetch_add(1, std::memory_order_relaxed);
+			return;
+		}
+		TraceEvent event = { name, start, end - start };
+		buffer.events[n] = event;
+		buffer.count.store(n + 1, std::memory_order_release);
+	}
+	// the calling thread's name in the trace viewer; a string literal, and free while not tracing
+	void nameThread(const char* name) {
+		threadName() = name;
+		if (TraceBuffer* buffer = ownBuffer()) {
+			std::lock_guard<std::mutex> lock(mutex);
+			buffer->threadName = name;
+		}
+	}
+
+	// everything recorded so far, from all threads; tracing carries on
+	bool dump(const std::string& path) {
+		std::ofstream out(path.c_str());
+		if (!out) {
+			std::cout << "ERROR::TRACE::FILE_NOT_WRITTEN: " << path << std::endl;
+			return false;
+		}
+		std::lock_guard<std::mutex> lock(mutex);
+		long long events = 0, dropped = 0;
+		out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+		bool first = true;
+		for (size_t b = 0; b < buffers.size(); b++) {
+			const TraceBuffer& buffer = *buffers[b];
+			if (!buffer.threadName.empty()) {
+				out << (first ? "" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer.threadId
+					<< ",\"args\":{\"name\":\"" << escape(buffer.threadName) << "\"}}";
+				first = false;
+			}
+			int count = buffer.count.load(std::memory_order_acquire);
+			for (int e = 0; e < count; e++) {
+				const TraceEvent& event = buffer.events[e];
+				out << (first ? "" : ",\n") << "{\"name\":\"" << escape(event.name) << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer.threadId
+					<< ",\"ts\":" << event.start << ",\"dur\":" << event.duration << "}";
+				first = false;
+			}
+			events += count;
+			dropped += buffer.dropped.load(std::memory_order_relaxed);
+		}
+		out << "\n]}\n";
+		printf("trace: %lld events from %d threads written to %s (%lld dropped)\n", events, static_cast<int>(buffers.size()), path.c_str(), dropped);
+		return true;
+	}
+
+private:
+	std::atomic<bool> on;
+	std::chrono::steady_clock::time_point origin;
+	std::mutex mutex;
+	// kept until exit, so the events of threads that have ended still get dumped
+	std::vector<std::unique_ptr<TraceBuffer>> buffers;
+
+	Tracer() : on(false) {
+	}
+
+	// created on the thread's first event
+	TraceBuffer& threadBuffer() {
+		TraceBuffer*& buffer = ownBuffer();
+		if (!buffer) {
+			std::lock_guard<std::mutex> lock(mutex);
+			buffers.push_back(std::unique_ptr<TraceBuffer>(new TraceBuffer(static_cast<int>(buffers.size()) + 1)));
+			buffer = buffers.back().get();
+			if (threadName())
+				buffer->threadName = threadName();
+		}
+		return *buffer;
+	}
+	static TraceBuffer*& ownBuffer() {
+		thread_local TraceBuffer* buffer = NULL;
+		return buffer;
+	}
+	static const char*& threadName() {
+		thread_local const char* name = NULL;
+		return name;
+	}
+
+	static std::string escape(const std::string& text) {
+		std::string escaped;
+		for (size_t i = 0; i < text.size(); i++) {
+			if (text[i] == '"' || text[i] == '\\')
+				escaped += '\\';
+			escaped += text[i];
+		}
+		return escaped;
+	}
+};
+
+// Records the enclosing block as one event while tracing is on; nearly free when it is off
+class TraceScope {
+
+public:
+	explicit TraceScope(const char* name) : name(name), start(Tracer::instance().enabled() ? Tracer::instance().now() : -1) {
+	}
+	~TraceScope() {
+		if (start >= 0)
+			Tracer::instance().record(name, start, Tracer::instance().now());
+	}
+
+private:
+	const char* name;
+	long long start;
+
+	TraceScope(const TraceScope&);
+	TraceScope& operator=(const TraceScope&);
+};
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+// TRACE_SCOPE("name"): times the rest of the block
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(traceScope, __LINE__)(name)
+
+#endif
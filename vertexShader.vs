@@ -1,16 +1,63 @@
 #version 330 core
+// variants (shader_variants.h): LIT for the shaded pass; without it only the position is
+// computed, for the depth pre-pass, the shadow maps and the occlusion boxes
 layout (location = 0) in vec3 aPos;
+#ifdef LIT
 layout (location = 1) in vec3 aColor;
+layout (location = 2) in vec3 aNormal;
 
 out vec4 color;
+out vec3 FragPos;
+out vec3 Normal;
+#endif
 
 
 uniform mat4 model;
+#ifdef LIT
+uniform mat3 normalMatrix;
+#endif
 uniform mat4 view;
 uniform mat4 projection;
 
+// rotating parts (see rotating_part.h); spinSpeed and spinPhase are 0 for static geometry
+uniform float time;
+uniform vec3 spinPivot;
+uniform vec3 spinAxis;
+uniform float spinSpeed;
+uniform float spinPhase;
+
+// the depth-only variant must produce bit-identical depth: both are built from this
+// file, so the expressions match, and the position is invariant in both programs
+invariant gl_Position;
+
+// Rodrigues' rotation of v about spinAxis
+vec3 spinVector(vec3 v, float c, float s)
+{
+    return v * c + cross(spinAxis, v) * s + spinAxis * dot(spinAxis, v) * (1.0 - c);
+}
+
 void main()
 {
-    gl_Position = projection * view * model * vec4(aPos, 1.0f);
+    vec3 worldPos = vec3(model * vec4(aPos, 1.0f));
+#ifdef LIT
+    vec3 worldNormal = normalMatrix * aNormal;
+#endif
+    float angle = radians(spinPhase + spinSpeed * time);
+    if (angle != 0.0)
+    {
+        float c = cos(angle);
+        float s = sin(angle);
+        worldPos = spinPivot + spinVector(worldPos - spinPivot, c, s);
+#ifdef LIT
+        worldNormal = spinVector(worldNormal, c, s);
+#endif
+    }
+#ifdef LIT
+    FragPos = worldPos;
+    Normal = worldNormal;
+#endif
+    gl_Position = projection * view * vec4(worldPos, 1.0f);
+#ifdef LIT
     color = vec4(aColor, 1.0f);
+#endif
 }
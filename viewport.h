@@ -0,0 +1,124 @@
+#pragma once
+#ifndef viewport_h
+#define viewport_h
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+#include <iostream>
+
+// Tracks the real framebuffer size (which differs from the window size on high-DPI
+// screens and changes on resize) and owns the perspective projection built from it.
+// The projection is only rebuilt when the size or the camera zoom actually changes.
+class Viewport {
+
+public:
+	int width, height;
+	float nearPlane, farPlane;
+	unsigned int generation;	// bumped on every size change; render targets compare against it
+
+	Viewport(int width, int height, float nearPlane = 0.1f, float farPlane = 100.0f)
+		: width(width), height(height), nearPlane(nearPlane), farPlane(farPlane), generation(0), cachedZoom(-1.0f) {
+	}
+
+	void resize(int newWidth, int newHeight) {
+		if (newWidth == width && newHeight == height)
+			return;
+		width = newWidth;
+		height = newHeight;
+		generation++;
+		cachedZoom = -1.0f;
+	}
+
+	// a minimised window reports a 0x0 framebuffer; there is nothing to draw into
+	bool minimized() const {
+		return width <= 0 || height <= 0;
+	}
+	float aspect() const {
+		return minimized() ? 1.0f : static_cast<float>(width) / static_cast<float>(height);
+	}
+
+	const glm::mat4& projection(float zoom) {
+		if (zoom != cachedZoom) {
+			cachedProjection = glm::perspective(glm::radians(zoom), aspect(), nearPlane, farPlane);
+			cachedZoom = zoom;
+		}
+		return cachedProjection;
+	}
+
+private:
+	float cachedZoom;	// zoom the cached projection was built with, -1 when stale
+	glm::mat4 cachedProjection;
+};
+
+// Offscreen colour + depth target that follows the viewport size (times 'scale').
+// It is recreated lazily: ensure() compares the viewport generation and only
+// reallocates on the first use after a resize, never inside the resize callback.
+class RenderTarget {
+
+public:
+	unsigned int FBO, colorTexture, depthTexture;
+	int width, height;
+	float scale;
+
+	RenderTarget(float scale = 1.0f)
+		: FBO(0), colorTexture(0), depthTexture(0), width(0), height(0), scale(scale), generation(0) {
+	}
+
+	// returns true when the target was (re)created
+	bool ensure(const Viewport& viewport) {
+		if (FBO != 0 && generation == viewport.generation)
+			return false;
+		release();
+		width = std::max(1, static_cast<int>(viewport.width * scale));
+		height = std::max(1, static_cast<int>(viewport.height * scale));
+		generation = viewport.generation;
+
+		glGenTextures(1, &colorTexture);
+		glBindTexture(GL_TEXTURE_2D, colorTexture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		glGenTextures(1, &depthTexture);
+		glBindTexture(GL_TEXTURE_2D, depthTexture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, width, height, 0, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		glGenFramebuffers(1, &FBO);
+		glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colorTexture, 0);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+			std::cout << "ERROR::FRAMEBUFFER:: Render target " << width << "x" << height << " is not complete" << std::endl;
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		return true;
+	}
+
+	// binds the target and sets the viewport to its size
+	void bind() const {
+		glBindFramebuffer(GL_FRAMEBUFFER, FBO);
+		glViewport(0, 0, width, height);
+	}
+
+	void release() {
+		if (FBO != 0) {
+			glDeleteFramebuffers(1, &FBO);
+			glDeleteTextures(1, &colorTexture);
+			glDeleteTextures(1, &depthTexture);
+		}
+		FBO = colorTexture = depthTexture = 0;
+	}
+
+private:
+	unsigned int generation;	// viewport generation the textures were sized for
+};
+
+#endif